@@ -6,7 +6,6 @@
 
 #define USE_PEXT
 
-#include <functional>
 #include <vector>
 #ifdef USE_PEXT
 #include <immintrin.h>
@@ -58,11 +57,6 @@ namespace {
         0x0011001800021025ULL, 0x00c9000400620811ULL, 0x0032009001080224ULL, 0x001400810044086aULL
     };
 
-    uint64_t KnightMoves[64];
-    uint64_t KingMoves[64];
-    uint64_t PawnCaps[2][64];
-    uint64_t PawnMoves[2][64];
-    uint64_t PawnMoves2[2][64];
     uint64_t RMagicAttacks[0x19000];
     uint64_t BMagicAttacks[0x1480];
 
@@ -109,75 +103,14 @@ namespace {
             } while (occ);
         }
     }
-
-    void initMovesTable(const std::vector<int>& D, uint64_t A[]) {
-        for (int i = 0; i < 0x40; i++) {
-            for (int j : D) {
-                int n = i + j;
-                if (n >= 0 && n < 64 && abs((n & 7) - (i & 7)) <= 2)
-                    A[i] |= BitMask[n];
-            }
-        }
-    }
-    uint64_t shiftLeft(uint64_t b, int i) {
-        return (b << i);
-    }
-    uint64_t shiftRight(uint64_t b, int i) {
-        return (b >> i);
-    }
-    uint64_t shiftLeft8(uint64_t b) {
-        return (b << 8);
-    }
-    uint64_t shiftRight8(uint64_t b) {
-        return (b >> 8);
-    }
-    uint64_t shiftLeft16(uint64_t b) {
-        return (b << 16);
-    }
-    uint64_t shiftRight16(uint64_t b) {
-        return (b >> 16);
-    }
-    uint64_t fillUp(uint64_t b) {
-        return b |= b << 8, b |= b << 16, b |= b << 32;
-    }
-    uint64_t fillDown(uint64_t b) {
-        return b |= b >> 8, b |= b >> 16, b |= b >> 32;
-    }
-    uint64_t fillUpEx(uint64_t b) {
-        return b |= b << 8, b |= b << 16, (b |= b << 32) << 8;
-    }
-    uint64_t fillDownEx(uint64_t b) {
-        return b |= b >> 8, b |= b >> 16, (b |= b >> 32) >> 8;
-    }
 }
 
 namespace Attacks {
     void initArr(void) {
-        initMovesTable({ -17, -10, 6, 15, 17, 10, -6, -15 }, KnightMoves);
-        initMovesTable({ -9, -1, 7, 8, 9, 1, -7, -8 }, KingMoves);
-        initMovesTable({ 8 }, PawnMoves[WHITE]);
-        initMovesTable({ -8 }, PawnMoves[BLACK]);
-        initMovesTable({ 7, 9 }, PawnCaps[WHITE]);
-        initMovesTable({ -7, -9 }, PawnCaps[BLACK]);
-        initMovesTable({ 16 }, PawnMoves2[WHITE]);
-        initMovesTable({ -16 }, PawnMoves2[BLACK]);
-
         initSliderTable(RMagicAttacks, RMagic, RookMagic, { -1, 8, 1, -8 });
         initSliderTable(BMagicAttacks, BMagic, BishopMagic, { -9, 7, 9, -7 });
     }
 
-    uint64_t pawnMovesBB(int from, uint64_t s) {
-        return PawnMoves[s][from];
-    }
-    uint64_t pawnMoves2BB(int from, uint64_t s) {
-        return PawnMoves2[s][from];
-    }
-    uint64_t pawnAttacksBB(int from, uint64_t s) {
-        return PawnCaps[s][from];
-    }
-    uint64_t knightAttacksBB(int from, uint64_t occ) {
-        return KnightMoves[from];
-    }
     uint64_t bishopAttacksBB(int from, uint64_t occ) {
         return BishopMagic[from].offset[sliderIndex(occ, BishopMagic[from])];
     }
@@ -193,25 +126,4 @@ namespace Attacks {
     uint64_t rookAttacksBBX(int from, uint64_t occ) {
         return rookAttacksBB(from, occ & ~(rookAttacksBB(from, occ) & occ));
     }
-    uint64_t kingAttacksBB(int from, uint64_t occ) {
-        return KingMoves[from];
-    }
-    uint64_t knightMovesBB(int from) {
-        return KnightMoves[from];
-    }
-    uint64_t kingMovesBB(int from) {
-        return KingMoves[from];
-    }
-    std::function<uint64_t(uint64_t, int i)> shiftBB[2] = { shiftLeft, shiftRight };
-    std::function<uint64_t(uint64_t)> shift8BB[2] = { shiftLeft8, shiftRight8 };
-    std::function<uint64_t(uint64_t)> shift16BB[2] = { shiftLeft16, shiftRight16 };
-    std::function<uint64_t(uint64_t)> fillBB[2] = { fillUp, fillDown };
-    std::function<uint64_t(uint64_t)> fillBBEx[2] = { fillUpEx, fillDownEx };
-
-    uint64_t pawnAttackBB(uint64_t pawns, size_t color) {
-        const int Shift[] = { 9, 7 };
-        uint64_t pawnAttackLeft = shiftBB[color](pawns, Shift[color ^ 1]) & ~FileHBB;
-        uint64_t pawnAttackright = shiftBB[color](pawns, Shift[color]) & ~FileABB;
-        return (pawnAttackLeft | pawnAttackright);
-    }
-}
\ No newline at end of file
+}
@@ -6,26 +6,70 @@
 
 #pragma once
 
-#include <functional>
+#include <initializer_list>
+#include "typedefs.h"
+#include "constants.h"
 
 namespace Attacks {
     extern void initArr(void);
-    extern uint64_t knightAttacksBB(int from, uint64_t occ);
-    extern uint64_t pawnMovesBB(int from, uint64_t s);
-    extern uint64_t pawnMoves2BB(int from, uint64_t s);
-    extern uint64_t pawnAttacksBB(int from, uint64_t s);
     extern uint64_t bishopAttacksBB(int from, uint64_t occ);
     extern uint64_t bishopAttacksBBX(int from, uint64_t occ);
     extern uint64_t rookAttacksBB(int from, uint64_t occ);
     extern uint64_t rookAttacksBBX(int from, uint64_t occ);
     extern uint64_t queenAttacksBB(int from, uint64_t occ);
-    extern uint64_t kingAttacksBB(int from, uint64_t occ);
-
-    extern uint64_t knightMovesBB(int from);
-    extern uint64_t kingMovesBB(int from);
-    extern std::function<uint64_t(uint64_t)> shift8BB[2];
-    extern std::function<uint64_t(uint64_t)> shift16BB[2];
-    extern std::function<uint64_t(uint64_t)> fillBB[2];
-    extern std::function<uint64_t(uint64_t)> fillBBEx[2];
-    extern uint64_t pawnAttackBB(uint64_t pawns, size_t color);
-}
\ No newline at end of file
+
+    // per square target sets of the leapers and pawns, built at compile time: a step is kept when it stays on
+    // the board and does not wrap around to the other edge
+    struct step_table_t {
+        constexpr uint64_t operator[](int sq) const { return bb[sq]; }
+        uint64_t bb[64];
+    };
+    constexpr step_table_t stepTable(std::initializer_list<int> steps) {
+        step_table_t t = {};
+        for (int sq = 0; sq < 64; ++sq) {
+            for (int d : steps) {
+                int to = sq + d, df = (to & 7) - (sq & 7);
+                if (to >= 0 && to < 64 && df >= -2 && df <= 2) t.bb[sq] |= 1ULL << to;
+            }
+        }
+        return t;
+    }
+    inline constexpr step_table_t KnightMoves = stepTable({ -17, -10, 6, 15, 17, 10, -6, -15 });
+    inline constexpr step_table_t KingMoves = stepTable({ -9, -1, 7, 8, 9, 1, -7, -8 });
+    inline constexpr step_table_t PawnMoves[2] = { stepTable({ 8 }), stepTable({ -8 }) };
+    inline constexpr step_table_t PawnMoves2[2] = { stepTable({ 16 }), stepTable({ -16 }) };
+    inline constexpr step_table_t PawnCaps[2] = { stepTable({ 7, 9 }), stepTable({ -7, -9 }) };
+
+    constexpr uint64_t knightMovesBB(int from) { return KnightMoves[from]; }
+    constexpr uint64_t kingMovesBB(int from) { return KingMoves[from]; }
+    constexpr uint64_t knightAttacksBB(int from, uint64_t occ) { return KnightMoves[from]; }
+    constexpr uint64_t kingAttacksBB(int from, uint64_t occ) { return KingMoves[from]; }
+    constexpr uint64_t pawnMovesBB(int from, int s) { return PawnMoves[s][from]; }
+    constexpr uint64_t pawnMoves2BB(int from, int s) { return PawnMoves2[s][from]; }
+    constexpr uint64_t pawnAttacksBB(int from, int s) { return PawnCaps[s][from]; }
+
+    // set-wise shifts and fills toward the side of the color, which is a template argument where the caller knows it
+    template <int color> constexpr uint64_t shift8(uint64_t b) { return color == WHITE ? b << 8 : b >> 8; }
+    template <int color> constexpr uint64_t shift16(uint64_t b) { return color == WHITE ? b << 16 : b >> 16; }
+    template <int color> constexpr uint64_t fill(uint64_t b) {
+        return color == WHITE ? (b |= b << 8, b |= b << 16, b | b << 32) : (b |= b >> 8, b |= b >> 16, b | b >> 32);
+    }
+    template <int color> constexpr uint64_t fillEx(uint64_t b) { return shift8<color>(fill<color>(b)); }
+    template <int color> constexpr uint64_t pawnAttacks(uint64_t pawns) {
+        return color == WHITE ? ((pawns << 7) & ~FileHBB) | ((pawns << 9) & ~FileABB)
+            : ((pawns >> 9) & ~FileHBB) | ((pawns >> 7) & ~FileABB);
+    }
+
+    constexpr uint64_t shift8BB(uint64_t b, int color) { return color == WHITE ? shift8<WHITE>(b) : shift8<BLACK>(b); }
+    constexpr uint64_t shift16BB(uint64_t b, int color) { return color == WHITE ? shift16<WHITE>(b) : shift16<BLACK>(b); }
+    constexpr uint64_t fillBB(uint64_t b, int color) { return color == WHITE ? fill<WHITE>(b) : fill<BLACK>(b); }
+    constexpr uint64_t fillBBEx(uint64_t b, int color) { return color == WHITE ? fillEx<WHITE>(b) : fillEx<BLACK>(b); }
+    constexpr uint64_t pawnAttackBB(uint64_t pawns, int color) {
+        return color == WHITE ? pawnAttacks<WHITE>(pawns) : pawnAttacks<BLACK>(pawns);
+    }
+
+    static_assert(knightMovesBB(A1) == (B3BB | C2BB), "knight table");
+    static_assert(kingMovesBB(H8) == (G8BB | G7BB | H7BB), "king table");
+    static_assert(pawnAttacksBB(A2, WHITE) == B3BB && pawnAttacksBB(H7, BLACK) == G6BB, "pawn capture table");
+    static_assert(pawnAttacks<WHITE>(A2BB | H2BB) == (B3BB | G3BB), "pawn attack shift");
+}
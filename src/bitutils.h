@@ -6,9 +6,54 @@
 
 #pragma once
 
+#include <cstdint>
+
+//#define NOPOPCNT
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#pragma intrinsic(_BitScanForward64)
+#pragma intrinsic(_BitScanReverse64)
+#endif
+
+// header only, so every scan and count compiles down to the instruction at the call site
 namespace BitUtils {
-    extern int getFirstBit(uint64_t b);
-    extern int getLastBit(uint64_t bb);
-    extern int popFirstBit(uint64_t& b);
-    extern int bitCnt(uint64_t b);
+    inline int getFirstBit(uint64_t b) {
+#ifdef _MSC_VER
+        unsigned long index = 0;
+        _BitScanForward64(&index, b);
+        return index;
+#else
+        return __builtin_ctzll(b);
+#endif
+    }
+
+    inline int getLastBit(uint64_t b) {
+#ifdef _MSC_VER
+        unsigned long index = 0;
+        _BitScanReverse64(&index, b);
+        return index;
+#else
+        return 63 ^ __builtin_clzll(b);
+#endif
+    }
+
+    inline int popFirstBit(uint64_t& b) {
+        int index = getFirstBit(b);
+        b &= (b - 1);
+        return index;
+    }
+
+    inline int bitCnt(uint64_t x) {
+#if defined(NOPOPCNT)
+        x -= (x >> 1) & 0x5555555555555555ULL;
+        x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+        x = (x + (x >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+        return (x * 0x0101010101010101ULL) >> 56;
+#elif defined(_MSC_VER)
+        return int(__popcnt64(x));
+#else
+        return __builtin_popcountll(x);
+#endif
+    }
 }
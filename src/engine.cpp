@@ -14,12 +14,13 @@
 #include "log.h"
 #include "movepicker.h"
 #include "engine.h"
+#include "nnue.h"
 
 engine_t::engine_t() {
     initUCIoptions();
     mht.init(2); // 2Mb
-    onHashChange();
     onThreadsChange();
+    onHashChange();
 }
 
 engine_t::~engine_t() {
@@ -79,14 +80,16 @@ void engine_t::initSearch() {
     cutoffcheck_depth = options["Cutoff Check Depth"].getIntVal();
     doNUMA = options["NUMA"].getIntVal();
 
-    if (doSMP = size() > 1) {
-        mht.clear();
-    }
+    // every busy mark is released as its move returns, so the table is idle here and only clearHash() wipes it
+    doSMP = size() > 1;
 
     for (auto& a : plysearched) a = false;
 
     for (auto t : *this) {
         t->pos = origpos;
+        t->pos.tt = doPrefetch ? &tt : nullptr;
+        t->pos.pawntable = doPrefetch ? &t->pawntable : nullptr;
+        t->pos.mattable = doPrefetch ? &t->mattable : nullptr;
         t->wakeup();
     }
 }
@@ -103,7 +106,26 @@ void engine_t::ponderhit() {
 }
 
 void engine_t::onHashChange() {
-    tt.init(options["Hash"].getIntVal());
+    const std::string pages = options["Huge Pages"].getStrVal();
+    const std::string segment = options["Hash Segment"].getStrVal();
+    tt.setPageMode(pages == "off" ? Utils::PAGES_OFF : (pages == "hugetlb" ? Utils::PAGES_HUGETLB : Utils::PAGES_MADVISE));
+    tt.setSegment(segment == "<empty>" ? "" : segment);
+    tt.setInterleave(options["NUMA"].getIntVal());
+    // a shared table is owned by all processes using it, so only a private one keeps its entries
+    if (tt.resizable() && segment == "<empty>") resizeHash(options["Hash"].getIntVal());
+    else {
+        tt.init(options["Hash"].getIntVal());
+        clearHash();
+    }
+    LogInfo() << "hash: " << options["Hash"].getIntVal() << "MB, " << tt.size() << " buckets, " << tt.size() * TT_BUCKET_SIZE << " entries";
+}
+
+// an unset or unreadable network file leaves the classical eval in charge
+void engine_t::onEvalFileChange() {
+    const std::string filename = options["EvalFile"].getStrVal();
+    if (filename == "<empty>") NNUE::unload();
+    else NNUE::load(filename);
+    LogInfo() << "eval: " << (NNUE::loaded() ? "nnue " + filename : std::string("classical"));
 }
 
 void engine_t::onThreadsChange() {
@@ -117,8 +139,71 @@ void engine_t::onThreadsChange() {
 
 void engine_t::newgame() {
     tt.resetAge();
-    tt.clear();
-    for (auto t : *this) t->et.clear();
+    clearHash();
+}
+
+// each search thread zeroes its own slice, so the pages are also first touched by the threads using them
+void engine_t::clearHash() {
+    int64_t start = Utils::getTime();
+    const size_t total = size();
+    for (size_t idx = 0; idx < total; ++idx) {
+        at(idx)->task = [this, idx, total] {
+            if (!tt.isShared()) tt.clear(idx, total); // other processes are using a shared table
+            mht.clear(idx, total);
+        };
+        at(idx)->wakeup();
+    }
+    waitForThreads();
+    LogInfo() << "hash clear: " << (Utils::getTime() - start) << " ms with " << total << " threads";
+}
+
+// each search thread fills its own slice of the new buckets, reading the old buckets that cover the same keys
+void engine_t::resizeHash(uint64_t mb) {
+    int64_t start = Utils::getTime();
+    const uint64_t before = tt.size() * TT_BUCKET_SIZE;
+    const size_t total = size();
+    std::vector<uint64_t> kept(total, 0);
+    tt.beginResize(mb);
+    for (size_t idx = 0; idx < total; ++idx) {
+        at(idx)->task = [this, idx, total, &kept] { kept[idx] = tt.rehash(idx, total); };
+        at(idx)->wakeup();
+    }
+    waitForThreads();
+    tt.endResize();
+    LogInfo() << "hash resize: " << std::accumulate(kept.begin(), kept.end(), uint64_t(0)) << " entries kept from " << before << " slots in "
+        << (Utils::getTime() - start) << " ms with " << total << " threads";
+}
+
+// the root moves are handed out one at a time to all threads, which share the perft hash; divide gets the
+// leaf count under each root move in generation order
+uint64_t engine_t::perft(const position_t& pos, int depth, perft_table_t* pt, std::vector<std::pair<move_t, uint64_t>>* divide) {
+    if (depth == 0) return 1;
+    movelist_t<256> rootmoves;
+    position_t root = pos;
+    root.genLegal(rootmoves);
+    std::vector<uint64_t> counts(rootmoves.size, 1);
+    if (depth > 1) {
+        std::atomic<int> next(0);
+        for (auto t : *this) {
+            t->task = [&, t] {
+                t->pos = pos;
+                t->pos.tt = nullptr;
+                t->pos.nnue = nullptr;
+                undo_t undo;
+                for (int idx; (idx = next++) < rootmoves.size;) {
+                    t->pos.doMove(undo, rootmoves.mv(idx));
+                    counts[idx] = t->perft2(depth - 1, pt);
+                    t->pos.undoMove(undo);
+                }
+            };
+            t->wakeup();
+        }
+        waitForThreads();
+    }
+    if (divide) {
+        for (int idx = 0; idx < rootmoves.size; ++idx) divide->push_back({ rootmoves.mv(idx), counts[idx] });
+    }
+    return std::accumulate(counts.begin(), counts.end(), uint64_t(0));
 }
 
 void engine_t::stopthreads() {
@@ -131,11 +216,14 @@ void engine_t::stopIteration() {
 
 void engine_t::initUCIoptions() {
     options["Hash"] = uci_options_t(256, 1, 65536, [&] { onHashChange(); });
+    options["Huge Pages"] = uci_options_t("madvise", { "off", "madvise", "hugetlb" }, [&] { onHashChange(); });
+    options["Hash Segment"] = uci_options_t(std::string("<empty>"), [&] { onHashChange(); });
     options["Threads"] = uci_options_t(8, 1, 4096, [&] { onThreadsChange(); });
     options["Ponder"] = uci_options_t(false, [&] {});
     options["ABDADA Depth"] = uci_options_t(3, 1, 128, [&] {});
     options["Cutoff Check Depth"] = uci_options_t(4, 1, 128, [&] {});
-    options["NUMA"] = uci_options_t(false, [&] {});
+    options["NUMA"] = uci_options_t(false, [&] { onHashChange(); });
+    options["EvalFile"] = uci_options_t(std::string("<empty>"), [&] { onEvalFileChange(); });
 }
 
 void engine_t::printUCIoptions() {
@@ -146,4 +234,10 @@ uint64_t engine_t::nodesearched() {
     uint64_t nodes = 0;
     for (auto t : *this) nodes += t->nodecnt;
     return nodes;
+}
+
+uint64_t engine_t::evalscomputed() {
+    uint64_t evals = 0;
+    for (auto t : *this) evals += t->evalcnt;
+    return evals;
 }
\ No newline at end of file
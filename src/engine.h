@@ -48,6 +48,9 @@ struct uci_options_t {
     uci_options_t(std::string v, callback f) : type("string"), min(0), max(0), onChange(f) {
         defaultval = currval = v;
     }
+    uci_options_t(std::string v, std::vector<std::string> vars, callback f) : type("combo"), min(0), max(0), combo(vars), onChange(f) {
+        defaultval = currval = v;
+    }
     uci_options_t(bool v, callback f) : type("check"), min(0), max(0), onChange(f) {
         defaultval = currval = (v ? "true" : "false");
     }
@@ -69,6 +72,7 @@ struct uci_options_t {
     }
     std::string defaultval, currval, type;
     int min, max;
+    std::vector<std::string> combo;
     callback onChange;
 };
 
@@ -90,6 +94,7 @@ struct uci_options_map : public std::unordered_map<std::string, uci_options_t> {
                 log << "option name " << itr->first << " type " << opt.type;
                 if (opt.type != "button") log << " default " << opt.defaultval;
                 if (opt.type == "spin") log << " min " << opt.min << " max " << opt.max;
+                for (auto& var : opt.combo) log << " var " << var;
             }
         }
     }
@@ -101,17 +106,22 @@ struct engine_t : public std::vector<search_t*> {
     ~engine_t();
     void initSearch();
     void newgame();
+    void clearHash();
+    void resizeHash(uint64_t mb);
     void stopthreads();
     void stopIteration();
     void initUCIoptions();
     void printUCIoptions();
     void waitForThreads();
     void ponderhit();
+    uint64_t perft(const position_t& pos, int depth, perft_table_t* pt, std::vector<std::pair<move_t, uint64_t>>* divide = nullptr);
 
     void onHashChange();
     void onThreadsChange();
+    void onEvalFileChange();
 
     uint64_t nodesearched();
+    uint64_t evalscomputed();
 
     abdada_table_t mht;
     trans_table_t tt;
@@ -125,6 +135,7 @@ struct engine_t : public std::vector<search_t*> {
     int defer_depth;
     int cutoffcheck_depth;
     bool doNUMA;
+    bool doPrefetch = true;
 
     spinlock_t updatelock;
     std::atomic<bool> plysearched[MAXPLYSIZE];
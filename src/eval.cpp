@@ -12,6 +12,7 @@
 #include "constants.h"
 #include "attacks.h"
 #include "params.h"
+#include "nnue.h"
 
 #include <algorithm>
 
@@ -30,41 +31,45 @@ namespace {
     }
 }
 
-void eval_t::material(position_t & p, int side) {
-    scr[side] += MaterialValues[PAWN] * bitCnt(p.getPieceBB(PAWN, side));
-    scr[side] += MaterialValues[KNIGHT] * bitCnt(p.getPieceBB(KNIGHT, side));
-    scr[side] += MaterialValues[BISHOP] * bitCnt(p.getPieceBB(BISHOP, side));
-    scr[side] += MaterialValues[ROOK] * bitCnt(p.getPieceBB(ROOK, side));
-    scr[side] += MaterialValues[QUEEN] * bitCnt(p.getPieceBB(QUEEN, side));
-    if (bitCnt(p.getPieceBB(BISHOP, side)) == 2) {
-        scr[side] += BishopPair;
-    }
-    // TODO: material scaling like opposite colored bishops, KRkb, KRkn
-    // TODO: material recognizer (KBPk, KRPkr, insufficient material, etc)
-    // TODO: endgame knowledge (KRPkr, KRkp, KBPkb)
-}
-
-void eval_t::pawnstructure(position_t& p, int side) {
+template <int side>
+void eval_t::pawnterms(position_t& p, pawn_entry_t& pe) {
     const int xside = side ^ 1;
     const uint64_t pawns = p.getPieceBB(PAWN, side);
     const uint64_t xpawns = p.getPieceBB(PAWN, xside);
-    const uint64_t open = pawns & ~(pawns & fillBB[xside](xpawns));
-    const uint64_t connected = pawns & (pawnatks[side] | shift8BB[xside](pawnatks[side]));
-    const uint64_t doubled = pawns & fillBBEx[xside](pawns);
-    const uint64_t isolated = pawns & ~fillBB[xside](pawnfillatks[side]);
-    const uint64_t backward = pawns & ~isolated & shift8BB[xside]((pawnatks[xside] | xpawns) & ~pawnfillatks[side]);
-    scr[side] += PawnConnected * bitCnt(connected);
-    scr[side] -= PawnDoubled * bitCnt(doubled);
-    scr[side] -= PawnIsolated * bitCnt(isolated & ~open);
-    scr[side] -= PawnBackward * bitCnt(backward & ~open);
-    scr[side] -= PawnIsolatedOpen * bitCnt(isolated & open);
-    scr[side] -= PawnBackwardOpen * bitCnt(backward & open);
+    const uint64_t open = pawns & ~(pawns & fill<xside>(xpawns));
+    const uint64_t connected = pawns & (pe.pawnatks[side] | shift8<xside>(pe.pawnatks[side]));
+    const uint64_t doubled = pawns & fillEx<xside>(pawns);
+    const uint64_t isolated = pawns & ~fill<xside>(pe.pawnfillatks[side]);
+    const uint64_t backward = pawns & ~isolated & shift8<xside>((pe.pawnatks[xside] | xpawns) & ~pe.pawnfillatks[side]);
+    pe.scr[side] = score_t();
+    pe.scr[side] += PawnConnected * bitCnt(connected);
+    pe.scr[side] -= PawnDoubled * bitCnt(doubled);
+    pe.scr[side] -= PawnIsolated * bitCnt(isolated & ~open);
+    pe.scr[side] -= PawnBackward * bitCnt(backward & ~open);
+    pe.scr[side] -= PawnIsolatedOpen * bitCnt(isolated & open);
+    pe.scr[side] -= PawnBackwardOpen * bitCnt(backward & open);
+    pe.passers[side] = pawns & ~fillEx<xside>(p.piecesBB[PAWN]) & ~pe.pawnfillatks[xside];
+}
+
+void eval_t::pawnstructure(position_t& p, pawn_entry_t& pe) {
+    pe.pawnatks[WHITE] = pawnAttacks<WHITE>(p.getPieceBB(PAWN, WHITE));
+    pe.pawnatks[BLACK] = pawnAttacks<BLACK>(p.getPieceBB(PAWN, BLACK));
+    pe.pawnfillatks[WHITE] = fill<WHITE>(pe.pawnatks[WHITE]);
+    pe.pawnfillatks[BLACK] = fill<BLACK>(pe.pawnatks[BLACK]);
+    pe.pawnshelter[WHITE] = p.getPieceBB(PAWN, WHITE) & ~fillEx<WHITE>(p.getPieceBB(PAWN, WHITE));
+    pe.pawnshelter[BLACK] = p.getPieceBB(PAWN, BLACK) & ~fillEx<BLACK>(p.getPieceBB(PAWN, BLACK));
+    pe.pawnstorm[WHITE] = p.getPieceBB(PAWN, BLACK) & ~fillEx<WHITE>(p.getPieceBB(PAWN, BLACK));
+    pe.pawnstorm[BLACK] = p.getPieceBB(PAWN, WHITE) & ~fillEx<BLACK>(p.getPieceBB(PAWN, WHITE));
+    pawnterms<WHITE>(p, pe);
+    pawnterms<BLACK>(p, pe);
+    pe.key = p.stack.phash;
 }
 
-void eval_t::pieceactivity(position_t& p, int side) {
+template <int side>
+void eval_t::pieceactivity(position_t& p) {
     static const uint64_t OutpostMask[2] = { Rank4BB | Rank5BB | Rank6BB, Rank5BB | Rank4BB | Rank3BB };
     const int xside = side ^ 1;
-    const uint64_t mobmask = ~p.getPieceBB(KING, side) & ~pawnatks[xside] & ~(shift8BB[xside](p.occupiedBB) & p.getPieceBB(PAWN, side));
+    const uint64_t mobmask = ~p.getPieceBB(KING, side) & ~pawnatks[xside] & ~(shift8<xside>(p.occupiedBB) & p.getPieceBB(PAWN, side));
     const uint64_t outpostsqs = OutpostMask[side] & pawnatks[side] & ~pawnfillatks[xside];
 
     for (uint64_t pcbits = p.getPieceBB(KNIGHT, side); pcbits;) {
@@ -132,7 +137,8 @@ void eval_t::pieceactivity(position_t& p, int side) {
     }
 }
 
-basic_score_t eval_t::kingshelter(position_t& p, int sq, int side) {
+template <int side>
+basic_score_t eval_t::kingshelter(int sq) {
     const int file = FileWing[sqFile(sq)];
     basic_score_t shelter = 0;
     shelter += KingShelter1 * bitCnt(pawnshelter[side] & KingShelterBB[side][file]);
@@ -142,15 +148,16 @@ basic_score_t eval_t::kingshelter(position_t& p, int sq, int side) {
     return shelter;
 }
 
-void eval_t::kingsafety(position_t& p, int side) {
+template <int side>
+void eval_t::kingsafety(position_t& p) {
     const int xside = side ^ 1;
 
     if (!p.getPieceBB(QUEEN, side)) return;
     if (!(p.getPieceBB(ROOK, side) || p.getPieceBB(BISHOP, side) || p.getPieceBB(KNIGHT, side))) return;
 
-    basic_score_t shelter = kingshelter(p, p.kpos[side], side);
-    if (p.canCastleQS(side)) shelter = std::max(shelter, kingshelter(p, KingSquare[side][0], side));
-    if (p.canCastleKS(side)) shelter = std::max(shelter, kingshelter(p, KingSquare[side][2], side));
+    basic_score_t shelter = kingshelter<side>(p.kpos[side]);
+    if (p.canCastleQS(side)) shelter = std::max(shelter, kingshelter<side>(KingSquare[side][0]));
+    if (p.canCastleKS(side)) shelter = std::max(shelter, kingshelter<side>(KingSquare[side][2]));
     scr[side] += score_t(shelter, 0);
 
     if (katkrscnt[side] > 0) {
@@ -174,14 +181,15 @@ void eval_t::kingsafety(position_t& p, int side) {
     }
 }
 
-void eval_t::threats(position_t& p, int side) {
+template <int side>
+void eval_t::threats(position_t& p) {
     const int xside = side ^ 1;
     const uint64_t minors = p.getPieceBB(KNIGHT, xside) | p.getPieceBB(BISHOP, xside);
     const uint64_t weak = (allatks[side] & ~allatks[xside]) | (allatks2[side] & ~allatks2[xside] & ~pawnatks[xside]);
     const uint64_t safepush = ~pawnatks[xside] & ~p.occupiedBB;
-    const uint64_t pushtarget = pawnAttackBB(p.colorBB[xside] & ~p.piecesBB[PAWN], xside) & (allatks[side] | ~allatks[xside]);
-    uint64_t push = shift8BB[side](p.getPieceBB(PAWN, side)) & safepush;
-    push |= shift8BB[side](push & Rank3ByColorBB[side]) & safepush;
+    const uint64_t pushtarget = pawnAttacks<xside>(p.colorBB[xside] & ~p.piecesBB[PAWN]) & (allatks[side] | ~allatks[xside]);
+    uint64_t push = shift8<side>(p.getPieceBB(PAWN, side)) & safepush;
+    push |= shift8<side>(push & Rank3ByColorBB[side]) & safepush;
     scr[side] += PawnPush * bitCnt(push & pushtarget);
     scr[side] += WeakPawns * bitCnt(p.getPieceBB(PAWN, xside) & weak);
     scr[side] += PawnsxMinors * bitCnt(pawnatks[side] & minors);
@@ -193,13 +201,14 @@ void eval_t::threats(position_t& p, int side) {
     scr[side] += KingxRooks * bitCnt(kingMovesBB(p.kpos[side]) & p.getPieceBB(ROOK, xside) & weak);
 }
 
-void eval_t::passedpawns(position_t& p, int side) {
+template <int side>
+void eval_t::passedpawns(position_t& p) {
     const int xside = side ^ 1;
-    uint64_t passers = p.getPieceBB(PAWN, side) & ~fillBBEx[xside](p.piecesBB[PAWN]) & ~pawnfillatks[xside];
+    uint64_t passers = this->passers[side];
     if (!passers) return;
-    const uint64_t notblocked = ~shift8BB[xside](p.occupiedBB);
-    const uint64_t safepush = ~shift8BB[xside](allatks[xside]);
-    const uint64_t safeprom = ~fillBBEx[xside](allatks[xside] | p.colorBB[xside]);
+    const uint64_t notblocked = ~shift8<xside>(p.occupiedBB);
+    const uint64_t safepush = ~shift8<xside>(allatks[xside]);
+    const uint64_t safeprom = ~fillEx<xside>(allatks[xside] | p.colorBB[xside]);
     while (passers) {
         int sq = popFirstBit(passers);
         score_t local = PasserBonusMax;
@@ -212,48 +221,64 @@ void eval_t::passedpawns(position_t& p, int side) {
     }
 }
 
-basic_score_t eval_t::score(position_t& p) {
+basic_score_t eval_t::interpolate(int side) {
+    basic_score_t total_phase = QueenPhase * 2 + RookPhase * 4 + BishopPhase * 4 + KnightPhase * 4;
+    score_t score = scr[side] - scr[side ^ 1];
+    return (score.mg() * phase + score.eg() * (total_phase - phase)) / total_phase + Tempo;
+}
+
+// The network replaces all of it when the position carries accumulators.
+// With a window, returns early on material, psqt and pawn structure alone when they are LazyMargin outside it,
+// since mobility, king safety, passers and threats rarely move the score that far. The result is then only a
+// bound estimate and lazy is set.
+basic_score_t eval_t::score(position_t& p, int alpha, int beta) {
+    lazy = false;
+    lazyscore = 0;
+    if (p.nnue) return NNUE::evaluate(p);
     for (int color = WHITE; color <= BLACK; ++color) {
         scr[color] = p.stack.score[color];
     }
-    if (p.isMatIdxValid()) {
-        material_t& mat = getMaterial(p.mat_idx[WHITE], p.mat_idx[BLACK]);
-        if (mat.flags & 1) return 0;
-        phase = mat.phase;
-        scr[WHITE] += mat.value;
-    }
-    else {
-        for (int color = WHITE; color <= BLACK; ++color) {
-            material(p, color);
-        }
-        phase = QueenPhase * bitCnt(p.piecesBB[QUEEN]) + RookPhase * bitCnt(p.piecesBB[ROOK])
-            + BishopPhase * bitCnt(p.piecesBB[BISHOP]) + KnightPhase * bitCnt(p.piecesBB[KNIGHT]);
-    }
+    // material keys are never 0, so a cleared entry always misses
+    uint64_t mkey = materialKey(p.mat_idx[WHITE], p.mat_idx[BLACK]);
+    material_t mlocal;
+    material_t& mat = mattable ? mattable->getEntry(mkey) : mlocal;
+    if (!mattable || mat.key != mkey) computeMaterial(mat, p.mat_idx[WHITE], p.mat_idx[BLACK]);
+    if (mat.flags & 1) return 0;
+    phase = mat.phase;
+    scr[WHITE] += mat.value;
+    // a cleared table entry has key 0 and all-zero terms, which is exactly right for a position without pawns
+    pawn_entry_t local;
+    pawn_entry_t& pe = pawntable ? pawntable->getEntry(p.stack.phash) : local;
+    ++pawnprobes;
+    if (pawntable && pe.key == p.stack.phash) ++pawnhits;
+    else pawnstructure(p, pe);
     for (int color = WHITE; color <= BLACK; ++color) {
         katkrscnt[color] = kzoneatks[color] = atkweights[color] = 0;
         allatks2[color] = knightatks[color] = bishopatks[color] = rookatks[color] = queenatks[color] = 0;
         kingzone[color] = KingZoneBB[color][p.kpos[color]];
         allatks[color] = kingMovesBB(p.kpos[color]);
-        pawnatks[color] = pawnAttackBB(p.getPieceBB(PAWN, color), color);
-        pawnfillatks[color] = fillBB[color](pawnatks[color]);
+        pawnatks[color] = pe.pawnatks[color];
+        pawnfillatks[color] = pe.pawnfillatks[color];
+        pawnshelter[color] = pe.pawnshelter[color];
+        pawnstorm[color] = pe.pawnstorm[color];
+        passers[color] = pe.passers[color];
         allatks2[color] |= allatks[color] & pawnatks[color];
         allatks[color] |= pawnatks[color];
-        pawnshelter[color] = p.getPieceBB(PAWN, color);
-        pawnshelter[color] &= ~fillBBEx[color](pawnshelter[color]);
-        pawnstorm[color] = p.getPieceBB(PAWN, color ^ 1);
-        pawnstorm[color] &= ~fillBBEx[color](pawnstorm[color]);
+        scr[color] += pe.scr[color];
     }
-    for (int color = WHITE; color <= BLACK; ++color) {
-        pawnstructure(p, color);
-        pieceactivity(p, color);
+    lazyscore = interpolate(p.side);
+    if (lazyscore - LazyMargin >= beta || lazyscore + LazyMargin <= alpha) {
+        lazy = true;
+        ++lazyexits[lazyscore >= beta ? LAZY_HIGH : LAZY_LOW];
+        return lazyscore;
     }
-    for (int color = WHITE; color <= BLACK; ++color) {
-        kingsafety(p, color);
-        passedpawns(p, color);
-        threats(p, color);
-    }
-    basic_score_t total_phase = QueenPhase * 2 + RookPhase * 4 + BishopPhase * 4 + KnightPhase * 4;
-    score_t score = scr[p.side] - scr[p.side ^ 1];
-    basic_score_t scaled = (score.m*phase + (score.e*(total_phase - phase))) / total_phase;
-    return scaled + Tempo;
+    pieceactivity<WHITE>(p);
+    pieceactivity<BLACK>(p);
+    kingsafety<WHITE>(p);
+    passedpawns<WHITE>(p);
+    threats<WHITE>(p);
+    kingsafety<BLACK>(p);
+    passedpawns<BLACK>(p);
+    threats<BLACK>(p);
+    return interpolate(p.side);
 }
\ No newline at end of file
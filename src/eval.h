@@ -8,16 +8,35 @@
 
 #include "typedefs.h"
 #include "position.h"
+#include "trans.h"
+
+// everything the eval derives from the pawns alone, so positions with the same pawns share one entry
+struct pawn_entry_t {
+    uint64_t key;
+    uint64_t pawnatks[2];
+    uint64_t pawnfillatks[2];
+    uint64_t pawnshelter[2];
+    uint64_t pawnstorm[2];
+    uint64_t passers[2];
+    score_t scr[2];
+};
+
+typedef hashtable_t<pawn_entry_t> pawn_table_t;
+typedef hashtable_t<material_t> material_table_t;
+
+enum LazyExits { LAZY_HIGH, LAZY_LOW, LAZY_EXITS };
 
 struct eval_t {
-    void material(position_t& p, int side);
-    void pawnstructure(position_t& p, int side);
-    void pieceactivity(position_t& p, int side);
-    basic_score_t kingshelter(position_t& p, int sq, int side);
-    void kingsafety(position_t& p, int side);
-    void threats(position_t& p, int side);
-    void passedpawns(position_t& p, int side);
-    basic_score_t score(position_t& p);
+    // the terms are specialized on the side they score, so pawn directions and rank masks are constants
+    void pawnstructure(position_t& p, pawn_entry_t& pe);
+    template <int side> void pawnterms(position_t& p, pawn_entry_t& pe);
+    template <int side> void pieceactivity(position_t& p);
+    template <int side> basic_score_t kingshelter(int sq);
+    template <int side> void kingsafety(position_t& p);
+    template <int side> void threats(position_t& p);
+    template <int side> void passedpawns(position_t& p);
+    basic_score_t interpolate(int side);
+    basic_score_t score(position_t& p, int alpha = -INT_MAX, int beta = INT_MAX);
     uint64_t pawnatks[2];
     uint64_t knightatks[2];
     uint64_t bishopatks[2];
@@ -29,10 +48,19 @@ struct eval_t {
     uint64_t pawnfillatks[2];
     uint64_t pawnshelter[2];
     uint64_t pawnstorm[2];
+    uint64_t passers[2];
     basic_score_t katkrscnt[2];
     basic_score_t atkweights[2];
     basic_score_t kzoneatks[2];
 
     score_t scr[2];
     basic_score_t phase;
+
+    pawn_table_t* pawntable = nullptr; // per-thread cache keyed on stack.phash, null computes the pawn terms every time
+    material_table_t* mattable = nullptr; // per-thread cache keyed on the material indices, filled on first use of each signature
+    uint64_t pawnprobes = 0;
+    uint64_t pawnhits = 0;
+    bool lazy = false; // last score was the early exit estimate
+    basic_score_t lazyscore = 0; // material, psqt and pawn structure part of the last score
+    uint64_t lazyexits[LAZY_EXITS] = {};
 };
@@ -16,6 +16,5 @@ int main(void) {
 
 // TODO:
 // history moves and other new history ideas
-// pawn hash
 // material imbalance
 // checks in qsearch at first level
\ No newline at end of file
@@ -17,10 +17,18 @@ using namespace PositionData;
 enum move_type {
     MT_PAWN, MT_PAWN2, MT_PAWNCAP, MT_PAWNPROM, MT_PAWNCAPPROM, MT_EP, MT_KNIGHT, MT_BISHOP, MT_ROOK, MT_QUEEM, MT_KING
 };
-static const std::function<uint64_t(int, uint64_t)> AttackFuncs[11] = {
-    pawnMovesBB, pawnMoves2BB, pawnAttacksBB, pawnMovesBB, pawnAttacksBB, pawnAttacksBB,
-    knightAttacksBB, bishopAttacksBB, rookAttacksBB, queenAttacksBB, kingAttacksBB
-};
+// resolved at compile time for each move type, SP is the side for pawns and the occupancy for pieces
+template <int mt>
+inline uint64_t attackFunc(int from, uint64_t sp) {
+    if constexpr (mt == MT_PAWN || mt == MT_PAWNPROM) return pawnMovesBB(from, int(sp));
+    else if constexpr (mt == MT_PAWN2) return pawnMoves2BB(from, int(sp));
+    else if constexpr (mt == MT_PAWNCAP || mt == MT_PAWNCAPPROM || mt == MT_EP) return pawnAttacksBB(from, int(sp));
+    else if constexpr (mt == MT_KNIGHT) return knightAttacksBB(from, sp);
+    else if constexpr (mt == MT_BISHOP) return bishopAttacksBB(from, sp);
+    else if constexpr (mt == MT_ROOK) return rookAttacksBB(from, sp);
+    else if constexpr (mt == MT_QUEEM) return queenAttacksBB(from, sp);
+    else return kingAttacksBB(from, sp);
+}
 static const PieceTypes Pieces[11] = {
     PAWN, PAWN, PAWN, PAWN, PAWN, PAWN, KNIGHT, BISHOP, ROOK, QUEEN, KING
 };
@@ -28,11 +36,18 @@ static const MoveFlags Flags[11] = {
     MF_NORMAL, MF_PAWN2, MF_NORMAL, MF_PROMN, MF_PROMN, MF_ENPASSANT, MF_NORMAL, MF_NORMAL, MF_NORMAL, MF_NORMAL, MF_NORMAL
 };
 
+// TBB is evaluated once per from square and may depend on it
 #define genMoves(mt, PCB, SP, TBB)\
-    for (uint64_t from, bits = getPieceBB(Pieces[mt], side) & PCB; bits;) {\
-        for (uint64_t mvbits = AttackFuncs[mt](int(from = popFirstBit(bits)), SP) & TBB; mvbits;) {\
+    for (uint64_t bits = getPieceBB(Pieces[mt], color) & (PCB); bits;) {\
+        const int from = popFirstBit(bits);\
+        for (uint64_t mvbits = attackFunc<mt>(from, SP) & (TBB); mvbits;) {\
             for (int to = popFirstBit(mvbits), fl = Flags[mt], fll = (Flags[mt] == MF_PROMN ? MF_PROMQ : Flags[mt]); fl <= fll; ++fl)\
-                mvlist.add(move_t(int(from), to, fl));}}
+                mvlist.add(move_t(from, to, fl));}}
+
+// pieces pinned to their king only move along the ray from the king through them, which ends at the pinner
+#define genPinnedMoves(mt, PCB, SP, TBB)\
+    genMoves(mt, (PCB) & ~pinned, SP, TBB);\
+    if (pinned) genMoves(mt, (PCB) & pinned, SP, (TBB) & DirBitmap[ksq][DirFromTo[ksq][from]]);
 
 #define genMovesPcs(PCB, TBB)\
     genMoves(MT_KNIGHT, PCB, occupiedBB, TBB);\
@@ -40,75 +55,153 @@ static const MoveFlags Flags[11] = {
     genMoves(MT_ROOK, PCB, occupiedBB, TBB);\
     genMoves(MT_QUEEM, PCB, occupiedBB, TBB);
 
+#define genPinnedMovesPcs(PCB, TBB)\
+    genMoves(MT_KNIGHT, (PCB) & ~pinned, occupiedBB, TBB);\
+    genPinnedMoves(MT_BISHOP, PCB, occupiedBB, TBB);\
+    genPinnedMoves(MT_ROOK, PCB, occupiedBB, TBB);\
+    genPinnedMoves(MT_QUEEM, PCB, occupiedBB, TBB);
+
 void position_t::genLegal(movelist_t<256>& mvlist) {
     if (kingIsInCheck())
         genCheckEvasions(mvlist);
     else {
-        movelist_t<256> mlt;
-        uint64_t pinned = pinnedPiecesBB(side);
-        genTacticalMoves(mlt);
-        genQuietMoves(mlt);
-        for (move_t m : mlt) {
-            if (!moveIsLegal(m, pinned, false)) continue;
-            mvlist.add(m);
-        }
+        genTacticalMoves(mvlist);
+        genQuietMoves(mvlist);
     }
 }
 
 void position_t::genQuietMoves(movelist_t<256>& mvlist) {
-    const int xside = side ^ 1;
-    if (canCastleKS(side) && !(occupiedBB & CastleSquareMask1[side][0]))
-        mvlist.add(move_t(CastleSquareFrom[side], CastleSquareTo[side][0], MF_CASTLE));
-    if (canCastleQS(side) && !(occupiedBB & CastleSquareMask1[side][1]))
-        mvlist.add(move_t(CastleSquareFrom[side], CastleSquareTo[side][1], MF_CASTLE));
-
-    genMoves(MT_PAWN, ~Rank7ByColorBB[side] & shift8BB[xside](~occupiedBB), side, ~occupiedBB);
-    genMoves(MT_PAWN2, Rank2ByColorBB[side] & shift8BB[xside](~occupiedBB) & shift16BB[xside](~occupiedBB), side, ~occupiedBB);
-    genMovesPcs(occupiedBB, ~occupiedBB);
-    genMoves(MT_KING, occupiedBB, 0, ~occupiedBB & ~kingMovesBB(kpos[xside]));
+    if (side == WHITE) genQuietMoves<WHITE>(mvlist);
+    else genQuietMoves<BLACK>(mvlist);
 }
 
 void position_t::genTacticalMoves(movelist_t<256>& mvlist) {
-    const int xside = side ^ 1;
+    if (side == WHITE) genTacticalMoves<WHITE>(mvlist);
+    else genTacticalMoves<BLACK>(mvlist);
+}
+
+void position_t::genCheckEvasions(movelist_t<256>& mvlist) {
+    if (side == WHITE) genCheckEvasions<WHITE>(mvlist);
+    else genCheckEvasions<BLACK>(mvlist);
+}
+
+void position_t::genQuietChecks(movelist_t<256>& mvlist) {
+    if (side == WHITE) genQuietChecks<WHITE>(mvlist);
+    else genQuietChecks<BLACK>(mvlist);
+}
+
+// all three generators below are strictly legal when the side to move is not in check: pinned pieces keep to
+// their pin ray, the king only steps onto squares that are safe once it has left its own, castling is tested
+// through the squares the king crosses and en passant through the two pawns leaving the board
+template <int color>
+void position_t::genQuietMoves(movelist_t<256>& mvlist) {
+    const int xside = color ^ 1;
+    const int ksq = kpos[color];
+    const uint64_t pinned = pinnedBB();
+    if (canCastleKS(color) && !(occupiedBB & CastleSquareMask1[color][0]) && !areaIsAttacked(xside, CastleSquareMask2[color][0]))
+        mvlist.add(move_t(CastleSquareFrom[color], CastleSquareTo[color][0], MF_CASTLE));
+    if (canCastleQS(color) && !(occupiedBB & CastleSquareMask1[color][1]) && !areaIsAttacked(xside, CastleSquareMask2[color][1]))
+        mvlist.add(move_t(CastleSquareFrom[color], CastleSquareTo[color][1], MF_CASTLE));
+
+    genPinnedMoves(MT_PAWN, ~Rank7ByColorBB[color] & shift8<xside>(~occupiedBB), color, ~occupiedBB);
+    genPinnedMoves(MT_PAWN2, Rank2ByColorBB[color] & shift8<xside>(~occupiedBB) & shift16<xside>(~occupiedBB), color, ~occupiedBB);
+    genPinnedMovesPcs(occupiedBB, ~occupiedBB);
+    genMoves(MT_KING, occupiedBB, 0, safeSqsBB(xside, occupiedBB ^ BitMask[ksq], ~occupiedBB & kingMovesBB(ksq)));
+}
+
+template <int color>
+void position_t::genTacticalMoves(movelist_t<256>& mvlist) {
+    const int xside = color ^ 1;
+    const int ksq = kpos[color];
+    const uint64_t pinned = pinnedBB();
     const uint64_t targetBB = colorBB[xside] & ~piecesBB[KING];
 
-    if (stack.epsq != -1)
-        genMoves(MT_EP, pawnAttacksBB(stack.epsq, xside), side, BitMask[stack.epsq]);
+    if (stack.epsq != -1) {
+        for (uint64_t bits = pawnAttacksBB(stack.epsq, xside) & getPieceBB(PAWN, color); bits;) {
+            const int from = popFirstBit(bits);
+            if (epIsLegal(from, stack.epsq)) mvlist.add(move_t(from, stack.epsq, MF_ENPASSANT));
+        }
+    }
 
-    genMoves(MT_PAWNPROM, Rank7ByColorBB[side], side, ~occupiedBB);
-    genMoves(MT_PAWNCAPPROM, Rank7ByColorBB[side], side, targetBB);
-    genMoves(MT_PAWNCAP, ~Rank7ByColorBB[side], side, targetBB);
-    genMovesPcs(occupiedBB, targetBB);
-    genMoves(MT_KING, occupiedBB, 0, targetBB & ~kingMovesBB(kpos[xside]));
+    genPinnedMoves(MT_PAWNPROM, Rank7ByColorBB[color], color, ~occupiedBB);
+    genPinnedMoves(MT_PAWNCAPPROM, Rank7ByColorBB[color], color, targetBB);
+    genPinnedMoves(MT_PAWNCAP, ~Rank7ByColorBB[color], color, targetBB);
+    genPinnedMovesPcs(occupiedBB, targetBB);
+    genMoves(MT_KING, occupiedBB, 0, safeSqsBB(xside, occupiedBB ^ BitMask[ksq], targetBB & kingMovesBB(ksq)));
 }
 
+// legal as well: pinned pieces can never resolve a check, so they do not move at all, and the en passant
+// capture of a checking pawn is still tested for a slider behind either pawn
+template <int color>
 void position_t::genCheckEvasions(movelist_t<256>& mvlist) {
-    const int xside = side ^ 1;
-    const int ksq = kpos[side];
-    const uint64_t checkersBB = getAttacksBB(ksq, xside);
+    const int xside = color ^ 1;
+    const int ksq = kpos[color];
+    const uint64_t checkers = checkersBB();
 
-    genMoves(MT_KING, occupiedBB, 0, safeSqsBB(xside, occupiedBB ^ BitMask[ksq], kingMovesBB(ksq)) & ~colorBB[side] & ~kingMovesBB(kpos[xside]));
+    genMoves(MT_KING, occupiedBB, 0, safeSqsBB(xside, occupiedBB ^ BitMask[ksq], kingMovesBB(ksq)) & ~colorBB[color] & ~kingMovesBB(kpos[xside]));
 
-    if (checkersBB & (checkersBB - 1)) return;
+    if (checkers & (checkers - 1)) return;
 
-    const int sqchecker = getFirstBit(checkersBB);
-    const uint64_t notpinned = ~pinnedPiecesBB(side);
+    const int sqchecker = getFirstBit(checkers);
+    const uint64_t notpinned = ~pinnedBB();
     const uint64_t inbetweenBB = InBetween[sqchecker][ksq];
 
     uint64_t pcbits = notpinned & pawnAttacksBB(sqchecker, xside);
-    genMoves(MT_PAWNCAP, pcbits & ~Rank7ByColorBB[side], side, checkersBB);
-    genMoves(MT_PAWNCAPPROM, pcbits & Rank7ByColorBB[side], side, checkersBB);
+    genMoves(MT_PAWNCAP, pcbits & ~Rank7ByColorBB[color], color, checkers);
+    genMoves(MT_PAWNCAPPROM, pcbits & Rank7ByColorBB[color], color, checkers);
 
-    if (checkersBB & getPieceBB(PAWN, xside) && (sqchecker + ((side == WHITE) ? 8 : -8)) == stack.epsq)
-        genMoves(MT_EP, notpinned, side, BitMask[stack.epsq]);
+    if (checkers & getPieceBB(PAWN, xside) && (sqchecker + (color == WHITE ? 8 : -8)) == stack.epsq) {
+        for (uint64_t bits = pawnAttacksBB(stack.epsq, xside) & getPieceBB(PAWN, color) & notpinned; bits;) {
+            const int from = popFirstBit(bits);
+            if (epIsLegal(from, stack.epsq)) mvlist.add(move_t(from, stack.epsq, MF_ENPASSANT));
+        }
+    }
 
-    genMovesPcs(notpinned, (inbetweenBB | checkersBB));
+    genMovesPcs(notpinned, (inbetweenBB | checkers));
 
     if (!inbetweenBB) return;
 
-    pcbits = notpinned & shift8BB[xside](inbetweenBB);
-    genMoves(MT_PAWN, pcbits & ~Rank7ByColorBB[side], side, inbetweenBB);
-    genMoves(MT_PAWNPROM, pcbits & Rank7ByColorBB[side], side, inbetweenBB);
-    pcbits = notpinned & shift8BB[xside](~occupiedBB) & shift16BB[xside](~occupiedBB) & shift16BB[xside](inbetweenBB);
-    genMoves(MT_PAWN2, pcbits & Rank2ByColorBB[side], side, inbetweenBB);
-}
\ No newline at end of file
+    pcbits = notpinned & shift8<xside>(inbetweenBB);
+    genMoves(MT_PAWN, pcbits & ~Rank7ByColorBB[color], color, inbetweenBB);
+    genMoves(MT_PAWNPROM, pcbits & Rank7ByColorBB[color], color, inbetweenBB);
+    pcbits = notpinned & shift8<xside>(~occupiedBB) & shift16<xside>(~occupiedBB) & shift16<xside>(inbetweenBB);
+    genMoves(MT_PAWN2, pcbits & Rank2ByColorBB[color], color, inbetweenBB);
+}
+
+// the quiet moves of genQuietMoves that give check, legal like them
+template <int color>
+void position_t::genQuietChecks(movelist_t<256>& mvlist) {
+    const int xside = color ^ 1;
+    const int ksq = kpos[color];
+    const int eksq = kpos[xside];
+    const uint64_t pinned = pinnedBB();
+    const uint64_t dcc = discoveredBB();
+    const uint64_t emptyBB = ~occupiedBB;
+
+    // discovered checks first: every quiet move of a discoverer that leaves its line to the enemy king
+    int first = mvlist.size;
+    genPinnedMoves(MT_PAWN, dcc & ~Rank7ByColorBB[color] & shift8<xside>(emptyBB), color, emptyBB);
+    genPinnedMoves(MT_PAWN2, dcc & Rank2ByColorBB[color] & shift8<xside>(emptyBB) & shift16<xside>(emptyBB), color, emptyBB);
+    genPinnedMovesPcs(dcc, emptyBB);
+    genMoves(MT_KING, dcc, 0, safeSqsBB(xside, occupiedBB ^ BitMask[ksq], emptyBB & kingMovesBB(ksq)));
+    int last = first;
+    for (int idx = first; idx < mvlist.size; ++idx) {
+        move_t m = mvlist.mv(idx);
+        if (DirFromTo[m.moveFrom()][eksq] != DirFromTo[m.moveTo()][eksq]) mvlist.mv(last++) = m;
+    }
+    mvlist.size = last;
+
+    // direct checks by the other pieces, onto the check squares of their type
+    genPinnedMoves(MT_PAWN, ~dcc & ~Rank7ByColorBB[color] & shift8<xside>(emptyBB), color, emptyBB & checkSquaresBB(PAWN));
+    genPinnedMoves(MT_PAWN2, ~dcc & Rank2ByColorBB[color] & shift8<xside>(emptyBB) & shift16<xside>(emptyBB), color, emptyBB & checkSquaresBB(PAWN));
+    genMoves(MT_KNIGHT, ~dcc & ~pinned, occupiedBB, emptyBB & checkSquaresBB(KNIGHT));
+    genPinnedMoves(MT_BISHOP, ~dcc, occupiedBB, emptyBB & checkSquaresBB(BISHOP));
+    genPinnedMoves(MT_ROOK, ~dcc, occupiedBB, emptyBB & checkSquaresBB(ROOK));
+    genPinnedMoves(MT_QUEEM, ~dcc, occupiedBB, emptyBB & checkSquaresBB(QUEEN));
+
+    for (int wing = 0; wing <= 1; ++wing) {
+        if (!(wing ? canCastleQS(color) : canCastleKS(color)) || (occupiedBB & CastleSquareMask1[color][wing])) continue;
+        move_t m(CastleSquareFrom[color], CastleSquareTo[color][wing], MF_CASTLE);
+        if (moveIsCheck(m, dcc) && !areaIsAttacked(xside, CastleSquareMask2[color][wing])) mvlist.add(m);
+    }
+}
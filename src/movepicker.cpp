@@ -10,7 +10,7 @@
 
 movepicker_t::movepicker_t(search_t& search, bool inCheck, bool inQS, int marg, uint16_t hmove, uint16_t k1, uint16_t k2, uint16_t cm)
     : s(search), pos(s.pos), idx(0), hashmove(hmove), killer1(k1), killer2(k2), counter(cm), inQSearch(inQS), margin(marg) {
-    pinned = pos.pinnedPiecesBB(pos.side);
+    pinned = pos.pinnedBB();
     if (inCheck) {
         pos.genCheckEvasions(mvlist);
         scoreEvasions();
@@ -46,6 +46,7 @@ bool movepicker_t::getMoves(move_t& move, bool skipquiets) {
             if (pos.moveIsValid(move, pinned) && pos.moveIsLegal(move, pinned, false))
                 return true;
             else {
+                ++s.ttstats.collisions;
                 LogAndPrintOutput() << "Hashmove not valid!";
                 LogAndPrintOutput() << move.to_str();
                 LogAndPrintOutput() << pos.to_str();
@@ -64,8 +65,7 @@ bool movepicker_t::getMoves(move_t& move, bool skipquiets) {
                     mvlistbad.add(move);
                 continue;
             }
-            if (pos.moveIsLegal(move, pinned, false))
-                return true;
+            return true;
         }
         if (inQSearch) return false;
         ++stage;
@@ -104,8 +104,7 @@ bool movepicker_t::getMoves(move_t& move, bool skipquiets) {
                 if (move.m == killer1) continue;
                 if (move.m == killer2) continue;
                 if (move.m == counter) continue;
-                if (pos.moveIsLegal(move, pinned, false))
-                    return true;
+                return true;
             }
         }
         ++stage;
@@ -114,8 +113,7 @@ bool movepicker_t::getMoves(move_t& move, bool skipquiets) {
         while (idx < mvlistbad.size) { // no need to order, ordered already
             move = mvlistbad.mv(idx++);
             if (move.m == hashmove) continue;
-            if (pos.moveIsLegal(move, pinned, false))
-                return true;
+            return true;
         }
         ++stage;
         idx = 0;
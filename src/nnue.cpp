@@ -0,0 +1,167 @@
+/**************************************************/
+/*  Invictus 2021                                 */
+/*  Edsel Apostol                                 */
+/*  ed_apostol@yahoo.com                          */
+/**************************************************/
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#include "typedefs.h"
+#include "position.h"
+#include "bitutils.h"
+#include "log.h"
+#include "nnue.h"
+
+using namespace BitUtils;
+
+namespace NNUE {
+    namespace {
+        alignas(64) int16_t FeatureBias[HIDDEN];
+        alignas(64) int16_t FeatureWeights[INPUTS][HIDDEN];
+        alignas(64) int16_t OutputWeights[2][HIDDEN];
+        int32_t OutputBias;
+        bool Loaded = false;
+
+        // acc = prev + added rows - removed rows, one pass over the accumulator per side
+        void update(int16_t* acc, const int16_t* prev, const int* add, int added, const int* remove, int removed) {
+#if defined(__AVX2__)
+            for (int i = 0; i < HIDDEN; i += 16) {
+                __m256i x = _mm256_load_si256((const __m256i*)(prev + i));
+                for (int a = 0; a < added; ++a) x = _mm256_add_epi16(x, _mm256_load_si256((const __m256i*)(FeatureWeights[add[a]] + i)));
+                for (int r = 0; r < removed; ++r) x = _mm256_sub_epi16(x, _mm256_load_si256((const __m256i*)(FeatureWeights[remove[r]] + i)));
+                _mm256_store_si256((__m256i*)(acc + i), x);
+            }
+#elif defined(__SSE2__)
+            for (int i = 0; i < HIDDEN; i += 8) {
+                __m128i x = _mm_load_si128((const __m128i*)(prev + i));
+                for (int a = 0; a < added; ++a) x = _mm_add_epi16(x, _mm_load_si128((const __m128i*)(FeatureWeights[add[a]] + i)));
+                for (int r = 0; r < removed; ++r) x = _mm_sub_epi16(x, _mm_load_si128((const __m128i*)(FeatureWeights[remove[r]] + i)));
+                _mm_store_si128((__m128i*)(acc + i), x);
+            }
+#else
+            for (int i = 0; i < HIDDEN; ++i) {
+                int16_t x = prev[i];
+                for (int a = 0; a < added; ++a) x += FeatureWeights[add[a]][i];
+                for (int r = 0; r < removed; ++r) x -= FeatureWeights[remove[r]][i];
+                acc[i] = x;
+            }
+#endif
+        }
+
+        // sum of clip(acc, 0, QA) * weights
+        int32_t output(const int16_t* acc, const int16_t* weights) {
+#if defined(__AVX2__)
+            const __m256i zero = _mm256_setzero_si256(), qa = _mm256_set1_epi16(QA);
+            __m256i sum = _mm256_setzero_si256();
+            for (int i = 0; i < HIDDEN; i += 16) {
+                __m256i x = _mm256_min_epi16(_mm256_max_epi16(_mm256_load_si256((const __m256i*)(acc + i)), zero), qa);
+                sum = _mm256_add_epi32(sum, _mm256_madd_epi16(x, _mm256_load_si256((const __m256i*)(weights + i))));
+            }
+            __m128i s = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+            s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0x4e));
+            s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0xb1));
+            return _mm_cvtsi128_si32(s);
+#elif defined(__SSE2__)
+            const __m128i zero = _mm_setzero_si128(), qa = _mm_set1_epi16(QA);
+            __m128i sum = _mm_setzero_si128();
+            for (int i = 0; i < HIDDEN; i += 8) {
+                __m128i x = _mm_min_epi16(_mm_max_epi16(_mm_load_si128((const __m128i*)(acc + i)), zero), qa);
+                sum = _mm_add_epi32(sum, _mm_madd_epi16(x, _mm_load_si128((const __m128i*)(weights + i))));
+            }
+            sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4e));
+            sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xb1));
+            return _mm_cvtsi128_si32(sum);
+#else
+            int32_t sum = 0;
+            for (int i = 0; i < HIDDEN; ++i) sum += std::min(std::max<int32_t>(acc[i], 0), QA) * weights[i];
+            return sum;
+#endif
+        }
+
+        void refresh(accumulator_t& acc, position_t& p) {
+            for (int persp = WHITE; persp <= BLACK; ++persp) {
+                int features[32], count = 0;
+                for (uint64_t pcbits = p.occupiedBB; pcbits;) {
+                    int sq = popFirstBit(pcbits);
+                    features[count++] = feature(persp, p.getSide(sq), p.getPiece(sq), sq);
+                }
+                update(acc.v[persp], FeatureBias, features, count, nullptr, 0);
+            }
+            acc.computed = true;
+        }
+
+        int score(const accumulator_t& acc, int side) {
+            int64_t sum = int64_t(output(acc.v[side], OutputWeights[0])) + output(acc.v[side ^ 1], OutputWeights[1]) + OutputBias;
+            return int(sum * SCALE / (QA * QB));
+        }
+    }
+
+    bool load(const std::string& filename) {
+        char magic[8];
+        uint32_t version = 0, hidden = 0;
+        std::ifstream file(filename, std::ios::binary);
+        file.read(magic, sizeof(magic));
+        file.read((char*)&version, sizeof(version));
+        file.read((char*)&hidden, sizeof(hidden));
+        if (!file || memcmp(magic, "INVINNUE", sizeof(magic)) || version != VERSION || hidden != HIDDEN) {
+            LogInfo() << "nnue: " << filename << " is not a version " << VERSION << " network with " << HIDDEN << " hidden neurons";
+            unload();
+            return false;
+        }
+        file.read((char*)FeatureBias, sizeof(FeatureBias));
+        file.read((char*)FeatureWeights, sizeof(FeatureWeights));
+        file.read((char*)OutputWeights, sizeof(OutputWeights));
+        file.read((char*)&OutputBias, sizeof(OutputBias));
+        if (!file || file.peek() != EOF) {
+            LogInfo() << "nnue: " << filename << " has the wrong size";
+            unload();
+            return false;
+        }
+        Loaded = true;
+        LogInfo() << "nnue: loaded " << filename;
+        return true;
+    }
+
+    void unload() {
+        Loaded = false;
+    }
+
+    bool loaded() {
+        return Loaded;
+    }
+
+    // the root accumulator is computed in full, every later one is derived from its parent on demand
+    void reset(acc_stack_t& stack, position_t& p) {
+        stack.top = 0;
+        refresh(stack.entries[0], p);
+    }
+
+    // brings the accumulator on top of the stack up to date from the nearest computed one below it
+    int evaluate(position_t& p) {
+        acc_stack_t& stack = *p.nnue;
+        int last = stack.top;
+        while (!stack.entries[last].computed) --last;
+        for (int i = last + 1; i <= stack.top; ++i) {
+            accumulator_t& acc = stack.entries[i];
+            int add[2], remove[2];
+            for (int a = 0; a < acc.added; ++a) add[a] = mirror(acc.add[a]);
+            for (int r = 0; r < acc.removed; ++r) remove[r] = mirror(acc.remove[r]);
+            update(acc.v[WHITE], stack.entries[i - 1].v[WHITE], acc.add, acc.added, acc.remove, acc.removed);
+            update(acc.v[BLACK], stack.entries[i - 1].v[BLACK], add, acc.added, remove, acc.removed);
+            acc.computed = true;
+        }
+        return score(stack.entries[stack.top], p.side);
+    }
+
+    // from scratch, to check the incremental updates
+    int evaluateFull(position_t& p) {
+        static thread_local accumulator_t acc;
+        refresh(acc, p);
+        return score(acc, p.side);
+    }
+}
@@ -0,0 +1,60 @@
+/**************************************************/
+/*  Invictus 2021                                 */
+/*  Edsel Apostol                                 */
+/*  ed_apostol@yahoo.com                          */
+/**************************************************/
+
+#pragma once
+
+#include <string>
+#include "typedefs.h"
+
+struct position_t;
+
+// A 768 -> 2x256 -> 1 network: one input per colour, piece and square seen from each side, a first layer
+// whose sums (the accumulators) are updated incrementally as moves are made, and a clipped relu output layer.
+// Network file, little endian:
+//   char magic[8] "INVINNUE", uint32 version, uint32 hidden size,
+//   int16 feature bias[256], int16 feature weights[768][256], int16 output weights[2][256], int32 output bias
+namespace NNUE {
+    const int INPUTS = 768;
+    const int HIDDEN = 256;
+    const int QA = 255; // accumulator clip, feature weights are scaled by it
+    const int QB = 64; // output weight scale
+    const int SCALE = 400; // network output to centipawns
+    const uint32_t VERSION = 1;
+
+    // the first layer change made by one move: at most two features added and two removed (castling)
+    struct accumulator_t {
+        alignas(32) int16_t v[2][HIDDEN];
+        bool computed;
+        int added, removed;
+        int add[2], remove[2];
+    };
+
+    struct acc_stack_t {
+        accumulator_t& push() {
+            accumulator_t& acc = entries[++top];
+            acc.computed = false, acc.added = acc.removed = 0;
+            return acc;
+        }
+        void pop() { --top; }
+        accumulator_t entries[MAXPLYSIZE + 4];
+        int top = 0;
+    };
+
+    inline int feature(int persp, int c, int pc, int sq) {
+        return ((c != persp) * 6 + pc - PAWN) * 64 + (persp == WHITE ? sq : sq ^ 56);
+    }
+    // changes are recorded from white's side, black sees the other colour on the mirrored square
+    inline int mirror(int f) { return (f < 384 ? f + 384 : f - 384) ^ 56; }
+    inline void addPiece(accumulator_t& acc, int c, int pc, int sq) { acc.add[acc.added++] = feature(WHITE, c, pc, sq); }
+    inline void removePiece(accumulator_t& acc, int c, int pc, int sq) { acc.remove[acc.removed++] = feature(WHITE, c, pc, sq); }
+
+    extern bool load(const std::string& filename);
+    extern void unload();
+    extern bool loaded();
+    extern void reset(acc_stack_t& stack, position_t& p);
+    extern int evaluate(position_t& p);
+    extern int evaluateFull(position_t& p);
+}
@@ -5,6 +5,7 @@
 /**************************************************/
 
 #include <cstring>
+#include <functional>
 #include "params.h"
 #include "attacks.h"
 #include "log.h"
@@ -71,6 +72,7 @@ namespace EvalParam {
     score_t OutpostBonus = { 15, 15 };
     score_t BishopPawns = { 7, 9 };
     basic_score_t Tempo = 37;
+    basic_score_t LazyMargin = 400;
 
     score_t PawnPush = { 19, 9 };
     score_t WeakPawns = { 2, 57 };
@@ -110,9 +112,6 @@ namespace EvalParam {
     uint64_t KingShelterBB[2][3];
     uint64_t KingShelter2BB[2][3];
     uint64_t KingShelter3BB[2][3];
-    material_t MaterialTable[486][486];
-
-    const int MatMul[8] = { 0,1,9,27,81,243,0,0 };
     const int KingSquare[2][3] = { {B1, E1, G1}, {B8, E8, G8} };
 
     void initArr() {
@@ -126,11 +125,11 @@ namespace EvalParam {
                 PcSqTab[BLACK][pc][sq] = pstInit[pc - 1](rsq);
                 //total += PcSqTab[WHITE][pc][sq];
             }
-            //PrintOutput() << "pc: " << pc << " Mid: " << total.m << " End: " << total.e;
+            //PrintOutput() << "pc: " << pc << " Mid: " << total.mg() << " End: " << total.eg();
         }
         for (int sq = 0; sq < 64; ++sq) {
             for (int color = WHITE; color <= BLACK; ++color) {
-                KingZoneBB[color][sq] = kingMovesBB(sq) | (1ull << sq) | shift8BB[color](kingMovesBB(sq));
+                KingZoneBB[color][sq] = kingMovesBB(sq) | (1ull << sq) | shift8BB(kingMovesBB(sq), color);
                 KingZoneBB[color][sq] |= sqFile(sq) == FileA ? KingZoneBB[color][sq] << 1 : 0;
                 KingZoneBB[color][sq] |= sqFile(sq) == FileH ? KingZoneBB[color][sq] >> 1 : 0;
             }
@@ -139,8 +138,8 @@ namespace EvalParam {
             for (int castle = 0; castle <= 2; ++castle) {
                 int sq = KingSquare[color][castle];
                 KingShelterBB[color][castle] = (kingMovesBB(sq) | (1ull << sq)) & Rank2ByColorBB[color];
-                KingShelter2BB[color][castle] = shift8BB[color](KingShelterBB[color][castle]);
-                KingShelter3BB[color][castle] = shift16BB[color](KingShelterBB[color][castle]);
+                KingShelter2BB[color][castle] = shift8BB(KingShelterBB[color][castle], color);
+                KingShelter3BB[color][castle] = shift16BB(KingShelterBB[color][castle], color);
             }
         }
     }
@@ -149,7 +148,7 @@ namespace EvalParam {
         for (int r = 56; r >= 0; r -= 8) {
             LogAndPrintOutput logger;
             for (int f = 0; f <= 7; ++f) {
-                logger << (midgame ? A[r + f].m : A[r + f].e) << " ";
+                logger << (midgame ? A[r + f].mg() : A[r + f].eg()) << " ";
             }
         }
         LogAndPrintOutput() << "\n\n";
@@ -166,46 +165,29 @@ namespace EvalParam {
             }
         }
     }
-    void initMaterial() {
-        //PrintOutput() << "sizeof(MaterialTable)): " << sizeof(MaterialTable);
-        memset(MaterialTable, 0, sizeof(MaterialTable));
-        for (int wq = 0; wq <= 1; wq++) for (int bq = 0; bq <= 1; bq++)
-            for (int wr = 0; wr <= 2; wr++) for (int br = 0; br <= 2; br++)
-                for (int wb = 0; wb <= 2; wb++) for (int bb = 0; bb <= 2; bb++)
-                    for (int wn = 0; wn <= 2; wn++) for (int bn = 0; bn <= 2; bn++)
-                        for (int wp = 0; wp <= 8; wp++) for (int bp = 0; bp <= 8; bp++) {
-                            int idx1 = wp * MatMul[PAWN] + wn * MatMul[KNIGHT] + wb * MatMul[BISHOP] + wr * MatMul[ROOK] + wq * MatMul[QUEEN];
-                            int idx2 = bp * MatMul[PAWN] + bn * MatMul[KNIGHT] + bb * MatMul[BISHOP] + br * MatMul[ROOK] + bq * MatMul[QUEEN];
-
-                            material_t &mat = MaterialTable[idx1][idx2];
-                            mat.phase = QueenPhase * (wq + bq) + RookPhase * (wr + br) + BishopPhase * (wb + bb) + KnightPhase * (wn + bn);
-                            mat.value = { 0, 0 };
-                            mat.flags = 0;
-
-                            for (int side = WHITE; side <= BLACK; ++side) {
-                                score_t scr;
-                                scr += MaterialValues[PAWN] * (side == WHITE ? wp : bp);
-                                scr += MaterialValues[KNIGHT] * (side == WHITE ? wn : bn);
-                                scr += MaterialValues[BISHOP] * (side == WHITE ? wb : bb);
-                                scr += MaterialValues[ROOK] * (side == WHITE ? wr : br);
-                                scr += MaterialValues[QUEEN] * (side == WHITE ? wq : bq);
-                                if ((side == WHITE ? wb : bb) == 2) scr += BishopPair;
-                                mat.value += scr * (side == WHITE ? 1 : -1);
-                            }
-
-                            int wminors = wn + wb;
-                            int bminors = bn + bb;
-                            int wmajors = wr + wq;
-                            int bmajors = br + bq;
-                            int minors = wminors + bminors;
-                            int majors = wmajors + bmajors;
-
-                            if (wp + bp + minors + majors == 0) mat.flags |= 1;
-                            else if (!wp && !bp && majors == 0 && wminors < 2 && bminors < 2) mat.flags |= 1;
-                            else if (!wp && !bp && majors == 0 && minors == 2 && (wn == 2 || bn == 2)) mat.flags |= 1;
-                        }
-    }
-    material_t& getMaterial(int idx1, int idx2) {
-        return MaterialTable[idx1][idx2];
+    void computeMaterial(material_t& mat, int idx1, int idx2) {
+        int wp = matCount(idx1, PAWN), wn = matCount(idx1, KNIGHT), wb = matCount(idx1, BISHOP), wr = matCount(idx1, ROOK), wq = matCount(idx1, QUEEN);
+        int bp = matCount(idx2, PAWN), bn = matCount(idx2, KNIGHT), bb = matCount(idx2, BISHOP), br = matCount(idx2, ROOK), bq = matCount(idx2, QUEEN);
+
+        mat.key = materialKey(idx1, idx2);
+        mat.phase = QueenPhase * (wq + bq) + RookPhase * (wr + br) + BishopPhase * (wb + bb) + KnightPhase * (wn + bn);
+        mat.value = { 0, 0 };
+        mat.flags = 0;
+
+        for (int side = WHITE; side <= BLACK; ++side) {
+            score_t scr;
+            scr += MaterialValues[PAWN] * (side == WHITE ? wp : bp);
+            scr += MaterialValues[KNIGHT] * (side == WHITE ? wn : bn);
+            scr += MaterialValues[BISHOP] * (side == WHITE ? wb : bb);
+            scr += MaterialValues[ROOK] * (side == WHITE ? wr : br);
+            scr += MaterialValues[QUEEN] * (side == WHITE ? wq : bq);
+            if ((side == WHITE ? wb : bb) == 2) scr += BishopPair;
+            mat.value += scr * (side == WHITE ? 1 : -1);
+        }
+        // TODO: material scaling like opposite colored bishops, KRkb, KRkn
+        // TODO: material recognizer (KBPk, KRPkr, insufficient material, etc)
+        // TODO: endgame knowledge (KRPkr, KRkp, KBPkb)
+
+        if (materialIsDrawn(idx1, idx2)) mat.flags |= 1;
     }
 }
@@ -37,6 +37,7 @@ namespace EvalParam {
     extern score_t OutpostBonus;
     extern score_t BishopPawns;
     extern basic_score_t Tempo;
+    extern basic_score_t LazyMargin;
 
     extern score_t PawnPush;
     extern score_t WeakPawns;
@@ -78,10 +79,24 @@ namespace EvalParam {
     extern uint64_t KingShelter3BB[2][3];
 
     extern const int KingSquare[2][3];
-    extern const int MatMul[8];
+
+    // mixed radix material index per side: up to 8 pawns, 10 knights, bishops or rooks and 9 queens,
+    // so every reachable material configuration has its own index
+    constexpr int MatMul[8] = { 0, 1, 9, 99, 1089, 11979, 0, 0 };
+    constexpr int MatRadix[8] = { 1, 9, 11, 11, 11, 10, 1, 1 };
+    constexpr int matCount(int idx, int pc) { return idx / MatMul[pc] % MatRadix[pc]; }
+    // both indices in one non-zero key, scrambled with an odd multiplier so the material cache index is spread
+    constexpr uint64_t materialKey(int idx1, int idx2) { return ((uint64_t(idx1) << 32 | uint64_t(idx2)) + 1) * 0x9E3779B97F4A7C15ULL; }
+    constexpr bool materialIsDrawn(int idx1, int idx2) {
+        int wminors = matCount(idx1, KNIGHT) + matCount(idx1, BISHOP), bminors = matCount(idx2, KNIGHT) + matCount(idx2, BISHOP);
+        int majors = matCount(idx1, ROOK) + matCount(idx1, QUEEN) + matCount(idx2, ROOK) + matCount(idx2, QUEEN);
+        if (matCount(idx1, PAWN) || matCount(idx2, PAWN) || majors) return false;
+        return (wminors < 2 && bminors < 2) || (wminors + bminors == 2 && (matCount(idx1, KNIGHT) == 2 || matCount(idx2, KNIGHT) == 2));
+    }
+    static_assert(matCount(8 * MatMul[PAWN] + 10 * MatMul[ROOK] + 9 * MatMul[QUEEN], QUEEN) == 9, "material radix");
+    static_assert(materialIsDrawn(0, 2 * MatMul[KNIGHT]) && !materialIsDrawn(MatMul[BISHOP], MatMul[KNIGHT] + MatMul[BISHOP]), "material draws");
 
     extern void initArr();
-    extern void initMaterial();
-    extern material_t& getMaterial(int idx1, int idx2);
+    extern void computeMaterial(material_t& mat, int idx1, int idx2);
     extern void displayPST();
 }
\ No newline at end of file
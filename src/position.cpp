@@ -16,6 +16,8 @@
 #include "log.h"
 #include "eval.h"
 #include "params.h"
+#include "trans.h"
+#include "nnue.h"
 
 namespace PositionData {
     const uint64_t  CastleSquareMask1[2][2] = { { F1BB | G1BB, B1BB | C1BB | D1BB }, { F8BB | G8BB, B8BB | C8BB | D8BB } };
@@ -117,10 +119,13 @@ void position_t::initPosition() {
 void position_t::undoNullMove(undo_t& undo) {
     side ^= 1;
     stack = undo;
+    if (nnue) nnue->pop();
 }
 
 void position_t::doNullMove(undo_t& undo) {
     undo = stack;
+    stack.ci.valid = 0;
+    if (nnue) nnue->push();
 
     stack.lastmove.m = 0;
     stack.epsq = -1;
@@ -130,6 +135,7 @@ void position_t::doNullMove(undo_t& undo) {
     if (undo.epsq != -1) stack.hash ^= ZobEpsq[sqFile(undo.epsq)];
 
     stack.hash ^= ZobColor;
+    if (tt) tt->prefetch(stack.hash);
     side ^= 1;
 }
 
@@ -183,63 +189,91 @@ void position_t::undoMove(undo_t& undo) {
     occupiedBB = colorBB[side] | colorBB[xside];
     stack = undo;
     history.pop_back();
+    if (nnue) nnue->pop();
 }
 
 void position_t::doMove(undo_t& undo, move_t m) {
     const int from = m.moveFrom();
     const int to = m.moveTo();
     const int xside = side ^ 1;
+    const int pc = pieces[from];
+    const int cap = pieces[to];
+    const int prom = m.movePromote();
 
-    ASSERT(pieces[to] != KING);
+    ASSERT(cap != KING);
 
     undo = stack;
+    stack.ci.valid = 0;
+    NNUE::accumulator_t* acc = nnue ? &nnue->push() : nullptr;
 
-    if (undo.epsq != -1) stack.hash ^= ZobEpsq[sqFile(undo.epsq)];
-    stack.hash ^= ZobCastle[undo.castle];
-
+    // the keys and material indices come first, so the table lines are on their way while the board is updated
     stack.lastmove = m;
     stack.epsq = -1;
     stack.castle &= CastleMask[from] & CastleMask[to];
-    stack.hash ^= ZobCastle[stack.castle];
     stack.fifty += 1;
     stack.pliesfromnull += 1;
-    stack.capturedpc = pieces[to];
-    stack.hash ^= ZobColor;
+    stack.capturedpc = cap;
+    if (undo.epsq != -1) stack.hash ^= ZobEpsq[sqFile(undo.epsq)];
+    stack.hash ^= ZobCastle[undo.castle] ^ ZobCastle[stack.castle] ^ ZobColor;
+    stack.hash ^= ZobPiece[side][pc][from] ^ ZobPiece[side][pc][to];
+    if (pc == PAWN) {
+        stack.phash ^= ZobPiece[side][pc][from] ^ ZobPiece[side][pc][to];
+        stack.fifty = 0;
+    }
+    if (cap != EMPTY) {
+        stack.hash ^= ZobPiece[xside][cap][to];
+        if (cap == PAWN) stack.phash ^= ZobPiece[xside][cap][to];
+        mat_idx[xside] -= MatMul[cap];
+        stack.fifty = 0;
+    }
+    switch (m.moveFlags()) {
+    case MF_PAWN2: {
+        const int epsq = (from + to) / 2;
+        if (piecesBB[PAWN] & colorBB[xside] & pawnAttacksBB(epsq, side)) {
+            stack.epsq = epsq;
+            stack.hash ^= ZobEpsq[sqFile(epsq)];
+        }
+    } break;
+    case MF_CASTLE: {
+        const int rook_from = RookFrom[to / 56][(to % 8) > 5];
+        const int rook_to = RookTo[to / 56][(to % 8) > 5];
+        stack.hash ^= ZobPiece[side][ROOK][rook_from] ^ ZobPiece[side][ROOK][rook_to];
+    } break;
+    case MF_ENPASSANT: {
+        const int epsq = (sqRank(from) << 3) + sqFile(to);
+        stack.hash ^= ZobPiece[xside][PAWN][epsq];
+        stack.phash ^= ZobPiece[xside][PAWN][epsq];
+        mat_idx[xside] -= MatMul[PAWN];
+    } break;
+    case MF_PROMQ: case MF_PROMR: case MF_PROMB: case MF_PROMN: {
+        stack.hash ^= ZobPiece[side][PAWN][to] ^ ZobPiece[side][prom][to];
+        stack.phash ^= ZobPiece[side][PAWN][to];
+        mat_idx[side] += MatMul[prom] - MatMul[PAWN];
+    } break;
+    }
+    if (tt) tt->prefetch(stack.hash);
+    if (pawntable) pawntable->prefetch(stack.phash);
+    if (mattable) mattable->prefetch(materialKey(mat_idx[WHITE], mat_idx[BLACK]));
 
-    const int pc = pieces[from];
-    pieces[to] = pieces[from];
+    if (acc) {
+        NNUE::removePiece(*acc, side, pc, from);
+        NNUE::addPiece(*acc, side, prom != EMPTY ? prom : pc, to);
+    }
+    pieces[to] = pc;
     pieces[from] = EMPTY;
     piecesBB[pc] ^= BitMask[from] | BitMask[to];
     colorBB[side] ^= BitMask[from] | BitMask[to];
     stack.score[side] += PcSqTab[side][pc][to];
     stack.score[side] -= PcSqTab[side][pc][from];
-    stack.hash ^= ZobPiece[side][pc][from] ^ ZobPiece[side][pc][to];
-    if (pc == PAWN) {
-        stack.phash ^= ZobPiece[side][pc][from] ^ ZobPiece[side][pc][to];
-        stack.fifty = 0;
-    }
     if (pc == KING) kpos[side] = to;
 
-    const int cap = stack.capturedpc;
     if (cap != EMPTY) {
         piecesBB[cap] ^= BitMask[to];
         colorBB[xside] ^= BitMask[to];
         stack.score[xside] -= PcSqTab[xside][cap][to];
-        stack.fifty = 0;
-        stack.hash ^= ZobPiece[xside][cap][to];
-        if (cap == PAWN)
-            stack.phash ^= ZobPiece[xside][cap][to];
-        mat_idx[xside] -= MatMul[cap];
+        if (acc) NNUE::removePiece(*acc, xside, cap, to);
     }
     switch (m.moveFlags()) {
-    case MF_PAWN2: {
-        stack.epsq = (from + to) / 2;
-        if (piecesBB[PAWN] & colorBB[xside] & pawnAttacksBB(stack.epsq, side))
-            stack.hash ^= ZobEpsq[sqFile(stack.epsq)];
-        else
-            stack.epsq = -1;
-        stack.fifty = 0;
-    } break;
     case MF_CASTLE: {
         const int rook_from = RookFrom[to / 56][(to % 8) > 5];
         const int rook_to = RookTo[to / 56][(to % 8) > 5];
@@ -249,32 +283,25 @@ void position_t::doMove(undo_t& undo, move_t m) {
         colorBB[side] ^= BitMask[rook_from] | BitMask[rook_to];
         stack.score[side] += PcSqTab[side][ROOK][rook_to];
         stack.score[side] -= PcSqTab[side][ROOK][rook_from];
-        stack.hash ^= ZobPiece[side][ROOK][rook_from] ^ ZobPiece[side][ROOK][rook_to];
+        if (acc) {
+            NNUE::removePiece(*acc, side, ROOK, rook_from);
+            NNUE::addPiece(*acc, side, ROOK, rook_to);
+        }
     } break;
     case MF_ENPASSANT: {
         const int epsq = (sqRank(from) << 3) + sqFile(to);
         pieces[epsq] = EMPTY;
-        mat_idx[xside] -= MatMul[PAWN];
         piecesBB[PAWN] ^= BitMask[epsq];
         colorBB[xside] ^= BitMask[epsq];
         stack.score[xside] -= PcSqTab[xside][PAWN][epsq];
-        stack.hash ^= ZobPiece[xside][PAWN][epsq];
-        stack.phash ^= ZobPiece[xside][PAWN][epsq];
-        stack.fifty = 0;
+        if (acc) NNUE::removePiece(*acc, xside, PAWN, epsq);
     } break;
     case MF_PROMQ: case MF_PROMR: case MF_PROMB: case MF_PROMN: {
-        const int prom = m.movePromote();
         piecesBB[PAWN] ^= BitMask[to]; // remove pawn
-        stack.hash ^= ZobPiece[side][PAWN][to];
-        stack.phash ^= ZobPiece[side][PAWN][to];
         pieces[to] = prom;
-        mat_idx[side] -= MatMul[PAWN];
-        mat_idx[side] += MatMul[prom];
         piecesBB[prom] ^= BitMask[to];
         stack.score[side] += PcSqTab[side][prom][to];
         stack.score[side] -= PcSqTab[side][PAWN][to];
-        stack.hash ^= ZobPiece[side][prom][to];
-        stack.fifty = 0;
     } break;
     }
     occupiedBB = colorBB[side] | colorBB[xside];
@@ -399,13 +426,8 @@ bool position_t::isRepeat() {
     return false;
 }
 
-bool position_t::isMatIdxValid() {
-    return mat_idx[0] < 486 && mat_idx[1] < 486;
-}
-
 bool position_t::isMatDrawn() {
-    if (isMatIdxValid() && getMaterial(mat_idx[0], mat_idx[1]).flags & 1) return true;
-    return false;
+    return materialIsDrawn(mat_idx[WHITE], mat_idx[BLACK]);
 }
 
 int position_t::getPiece(int sq) {
@@ -497,6 +519,36 @@ uint64_t position_t::discoveredPiecesBB(int c) {
     return pinned;
 }
 
+uint64_t position_t::pinnedBB() {
+    if (!(stack.ci.valid & CI_PINNED)) stack.ci.pinned = pinnedPiecesBB(side), stack.ci.valid |= CI_PINNED;
+    return stack.ci.pinned;
+}
+
+uint64_t position_t::discoveredBB() {
+    if (!(stack.ci.valid & CI_DISCOVERED)) stack.ci.discovered = discoveredPiecesBB(side), stack.ci.valid |= CI_DISCOVERED;
+    return stack.ci.discovered;
+}
+
+uint64_t position_t::checkersBB() {
+    if (!(stack.ci.valid & CI_CHECKERS)) stack.ci.checkers = getAttacksBB(kpos[side], side ^ 1), stack.ci.valid |= CI_CHECKERS;
+    return stack.ci.checkers;
+}
+
+uint64_t position_t::checkSquaresBB(int pc) {
+    if (!(stack.ci.valid & CI_CHECKSQS)) {
+        const int ksq = kpos[side ^ 1];
+        uint64_t* sqs = stack.ci.checksqs;
+        sqs[EMPTY] = sqs[KING] = 0;
+        sqs[PAWN] = pawnAttacksBB(ksq, side ^ 1);
+        sqs[KNIGHT] = knightMovesBB(ksq);
+        sqs[BISHOP] = bishopAttacksBB(ksq, occupiedBB);
+        sqs[ROOK] = rookAttacksBB(ksq, occupiedBB);
+        sqs[QUEEN] = sqs[BISHOP] | sqs[ROOK];
+        stack.ci.valid |= CI_CHECKSQS;
+    }
+    return stack.ci.checksqs[pc];
+}
+
 bool position_t::statExEval(move_t m, int threshold) {
     static const int StatExEvPcVals[] = { 0, 100,  450,  450,  675, 1300, 0 };
 
@@ -549,7 +601,7 @@ bool position_t::canCastleQS(int s) {
 }
 
 bool position_t::kingIsInCheck() {
-    return sqIsAttacked(occupiedBB, kpos[side], side ^ 1);
+    return checkersBB() != 0;
 }
 
 bool position_t::areaIsAttacked(int c, uint64_t target) {
@@ -576,10 +628,7 @@ bool position_t::moveIsLegal(move_t move, uint64_t pinned, bool incheck) {
     const int to = move.moveTo();
     const int ksq = kpos[side];
 
-    if (move.isEnPassant()) {
-        uint64_t b = occupiedBB ^ BitMask[from] ^ BitMask[(sqRank(from) << 3) + sqFile(to)] ^ BitMask[to];
-        return !(rookAttacksBB(ksq, b) & rookSlidersBB(xside)) && !(bishopAttacksBB(ksq, b) & bishopSlidersBB(xside));
-    }
+    if (move.isEnPassant()) return epIsLegal(from, to);
     if (move.isCastle()) {
         return !areaIsAttacked(xside, CastleSquareMask2[side][to > from ? 0 : 1]);
     }
@@ -589,6 +638,13 @@ bool position_t::moveIsLegal(move_t move, uint64_t pinned, bool incheck) {
     return false;
 }
 
+// the capturing and the captured pawn leave the board together, so a slider behind either may hit the king
+bool position_t::epIsLegal(int from, int to) {
+    const int ksq = kpos[side];
+    uint64_t b = occupiedBB ^ BitMask[from] ^ BitMask[(sqRank(from) << 3) + sqFile(to)] ^ BitMask[to];
+    return !(rookAttacksBB(ksq, b) & rookSlidersBB(side ^ 1)) && !(bishopAttacksBB(ksq, b) & bishopSlidersBB(side ^ 1));
+}
+
 bool position_t::moveIsCheck(move_t move, uint64_t dcc) {
     const int xside = side ^ 1;
     const int from = move.moveFrom();
@@ -598,8 +654,7 @@ bool position_t::moveIsCheck(move_t move, uint64_t dcc) {
     const int prom = move.movePromote();
 
     if ((dcc & BitMask[from]) && DirFromTo[from][enemy_ksq] != DirFromTo[to][enemy_ksq]) return true;
-    if (pc != PAWN && pc != KING && pieceAttacksFromBB(pc, enemy_ksq, occupiedBB)  & BitMask[to]) return true;
-    if (pc == PAWN && pawnAttacksBB(enemy_ksq, xside) & BitMask[to]) return true;
+    if (checkSquaresBB(pc) & BitMask[to]) return true;
     uint64_t tempOccBB = occupiedBB ^ BitMask[from] ^ BitMask[to];
     if (move.isPromote() && pieceAttacksFromBB(prom, enemy_ksq, tempOccBB)  & BitMask[to]) return true;
     if (move.isEnPassant() && sqIsAttacked(tempOccBB ^ BitMask[(sqRank(from) << 3) + sqFile(to)], enemy_ksq, side)) return true;
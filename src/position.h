@@ -7,6 +7,7 @@
 #pragma once
 
 namespace PositionData {
+    extern uint64_t DirBitmap[64][8];
     extern uint64_t InBetween[64][64];
     extern int DirFromTo[64][64];
     extern const uint64_t CastleSquareMask1[2][2];
@@ -18,6 +19,23 @@ namespace PositionData {
     extern void initArr(void);
 }
 
+class trans_table_t;
+template <typename hash_entity_t> class hashtable_t;
+struct pawn_entry_t;
+namespace NNUE { struct acc_stack_t; }
+
+enum CheckInfoFields { CI_PINNED = 1, CI_DISCOVERED = 2, CI_CHECKERS = 4, CI_CHECKSQS = 8 };
+
+// pins, discoverers, checkers and check squares of one node, each filled on first use. It lives in the per-ply stack, so
+// doMove starts the child empty and undoMove brings back whatever the parent had already worked out.
+struct check_info_t {
+    uint64_t pinned; // side to move pieces pinned to its own king
+    uint64_t discovered; // side to move pieces whose move may uncover a check on the enemy king
+    uint64_t checkers; // enemy pieces giving check
+    uint64_t checksqs[7]; // by piece type, the squares from which a piece of the side to move attacks the enemy king
+    int32_t valid; // CI_* bits of the fields above that are filled
+};
+
 struct undo_t {
     void init() {
         lastmove = 0;
@@ -30,6 +48,7 @@ struct undo_t {
         capturedpc = EMPTY;
         score[WHITE] = { 0, 0 };
         score[BLACK] = { 0, 0 };
+        ci.valid = 0;
     }
     move_t lastmove;
     int32_t castle;
@@ -40,11 +59,12 @@ struct undo_t {
     score_t score[2];
     uint64_t phash;
     uint64_t hash;
+    check_info_t ci;
 };
 
 struct position_t {
-    position_t() {}
-    position_t(const std::string & fen) { setPosition(fen); }
+    position_t() : tt(nullptr), pawntable(nullptr), mattable(nullptr), nnue(nullptr) {}
+    position_t(const std::string & fen) : tt(nullptr), pawntable(nullptr), mattable(nullptr), nnue(nullptr) { setPosition(fen); }
     void initPosition();
     void undoNullMove(undo_t& undo);
     void doNullMove(undo_t& undo);
@@ -56,7 +76,6 @@ struct position_t {
     std::string to_str();
 
     bool isRepeat();
-    bool isMatIdxValid();
     bool isMatDrawn();
     int getPiece(int sq);
     int getSide(int sq);
@@ -70,6 +89,11 @@ struct position_t {
     uint64_t getAttacksBB(int sq, int c);
     uint64_t pinnedPiecesBB(int c);
     uint64_t discoveredPiecesBB(int c);
+    // the same for the side to move, computed at most once per node through stack.ci
+    uint64_t pinnedBB();
+    uint64_t discoveredBB();
+    uint64_t checkersBB();
+    uint64_t checkSquaresBB(int pc);
 
     bool statExEval(move_t m, int threshold);
     bool canCastleKS(int s);
@@ -78,6 +102,7 @@ struct position_t {
     bool areaIsAttacked(int c, uint64_t target);
     bool sqIsAttacked(uint64_t occ, int sq, int c);
     bool moveIsLegal(move_t move, uint64_t pinned, bool incheck);
+    bool epIsLegal(int from, int to);
     bool moveIsCheck(move_t m, uint64_t dcc);
     bool moveIsValid(move_t move, uint64_t pinned);
     bool moveIsTactical(move_t m);
@@ -89,6 +114,12 @@ struct position_t {
     void genQuietMoves(movelist_t<256>& mvlist);
     void genTacticalMoves(movelist_t<256>& mvlist);
     void genCheckEvasions(movelist_t<256>& mvlist);
+    void genQuietChecks(movelist_t<256>& mvlist);
+    // specialized on the side to move, the functions above dispatch on side
+    template <int color> void genQuietMoves(movelist_t<256>& mvlist);
+    template <int color> void genTacticalMoves(movelist_t<256>& mvlist);
+    template <int color> void genCheckEvasions(movelist_t<256>& mvlist);
+    template <int color> void genQuietChecks(movelist_t<256>& mvlist);
 
     uint64_t occupiedBB;
     std::vector<uint64_t> history;
@@ -99,4 +130,8 @@ struct position_t {
     int mat_idx[2];
     undo_t stack;
     int side;
+    trans_table_t* tt; // prefetched by doMove/doNullMove as soon as the new key is known, null to disable
+    hashtable_t<pawn_entry_t>* pawntable; // the eval caches of the searching thread, prefetched by doMove alongside tt
+    hashtable_t<material_t>* mattable;
+    NNUE::acc_stack_t* nnue; // network accumulators kept in step with the moves, null for the classical eval
 };
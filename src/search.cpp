@@ -50,7 +50,8 @@ void search_t::idleloop() {
     while (!exit_flag) {
         if (do_sleep) wait();
         else {
-            start();
+            if (task) task(), task = nullptr;
+            else start();
             do_sleep = true;
         }
     }
@@ -62,15 +63,8 @@ uint64_t search_t::perft(size_t depth) {
     uint64_t cnt = 0ull;
     if (depth == 0) return 1ull;
     movelist_t<256> mvlist;
-    bool inCheck = pos.kingIsInCheck();
-    if (inCheck) pos.genCheckEvasions(mvlist);
-    else {
-        pos.genTacticalMoves(mvlist);
-        pos.genQuietMoves(mvlist);
-    }
-    uint64_t pinned = pos.pinnedPiecesBB(pos.side);
+    pos.genLegal(mvlist);
     for (move_t m : mvlist) {
-        if (!pos.moveIsLegal(m, pinned, inCheck)) continue;
         pos.doMove(undo, m);
         cnt += perft(depth - 1);
         pos.undoMove(undo);
@@ -78,25 +72,29 @@ uint64_t search_t::perft(size_t depth) {
     return cnt;
 }
 
-// use this for checking move generation: faster
-uint64_t search_t::perft2(int depth) {
+// use this for checking move generation: faster, the last ply only counts the legal moves and the subtrees
+// from depth 2 up are looked up in and stored to the perft hash when there is one
+uint64_t search_t::perft2(int depth, perft_table_t* pt) {
+    if (depth == 0) return 1ull;
+    uint64_t cnt = 0ull;
+    if (depth > 1 && pt && pt->retrieve(pos.stack.hash, depth, cnt)) return cnt;
     movelist_t<256> mvlist;
     pos.genLegal(mvlist);
     if (depth == 1) return mvlist.size;
     undo_t undo;
-    uint64_t cnt = 0ull;
     for (move_t m : mvlist) {
         pos.doMove(undo, m);
-        cnt += perft2(depth - 1);
+        cnt += perft2(depth - 1, pt);
         pos.undoMove(undo);
     }
+    if (pt) pt->store(pos.stack.hash, depth, cnt);
     return cnt;
 }
 
 void search_t::updateInfo() {
     uint64_t currtime = Utils::getTime() - e.start_time + 1;
     uint64_t totalnodes = e.nodesearched();
-    PrintOutput() << "info time " << currtime << " nodes " << totalnodes << " nps " << (totalnodes * 1000 / currtime);
+    PrintOutput() << "info time " << currtime << " nodes " << totalnodes << " nps " << (totalnodes * 1000 / currtime) << " hashfull " << e.tt.hashfull();
 }
 
 void search_t::displayInfo(move_t bestmove, int depth, int alpha, int beta) {
@@ -111,18 +109,25 @@ void search_t::displayInfo(move_t bestmove, int depth, int alpha, int beta) {
     else
         logger << " score mate " << ((bestmove.s > 0) ? (MATE - bestmove.s + 1) / 2 : -(MATE + bestmove.s) / 2);
     uint64_t totalnodes = e.nodesearched();
-    logger << " time " << currtime << " nodes " << totalnodes << " nps " << (totalnodes * 1000 / currtime) << " pv";
+    logger << " time " << currtime << " nodes " << totalnodes << " nps " << (totalnodes * 1000 / currtime) << " hashfull " << e.tt.hashfull() << " pv";
     for (move_t m : pvlist[0]) logger << " " << m.to_str();
 }
 
 void search_t::start() {
-    if (e.doNUMA) Utils::bindThisThread(thread_id); // NUMA bindings
+    Utils::bindThisThread(e.doNUMA ? thread_id : -1); // NUMA bindings
+    pos.nnue = NNUE::loaded() ? &nnuestack : nullptr;
+    if (pos.nnue) NNUE::reset(nnuestack, pos);
 
     memset(history, 0, sizeof(history));
     memset(countermove, 0, sizeof(countermove));
     memset(killer1, 0, sizeof(killer1));
     memset(killer2, 0, sizeof(killer2));
     nodecnt = 0;
+    evalcnt = 0;
+    eval.pawnprobes = eval.pawnhits = 0;
+    for (auto& n : eval.lazyexits) n = 0;
+    ttstats.clear();
+    abdadastats.clear();
     bool inCheck = pos.kingIsInCheck();
     int last_score = 0;
     int mate_count = 0;
@@ -220,7 +225,7 @@ int search_t::search(bool inRoot, bool inPv, int alpha, int beta, int depth, int
         if (stopSearch()) return 0;
         if (inPv && ply > maxplysearched) maxplysearched = ply;
         if (pos.stack.fifty > 99 || pos.isRepeat() || pos.isMatDrawn()) return 0;
-        if (ply >= MAXPLY) return et.retrieve(pos);
+        if (ply >= MAXPLY) return eval.score(pos);
         alpha = std::max(alpha, -MATE + ply);
         beta = std::min(beta, MATE - ply - 1);
         if (alpha >= beta) return alpha;
@@ -228,15 +233,20 @@ int search_t::search(bool inRoot, bool inPv, int alpha, int beta, int depth, int
 
     tt_entry_t tte;
     tte.move.m = 0;
-    if (e.tt.retrieve(pos.stack.hash, tte)) {
+    bool tthit = e.tt.retrieve(pos.stack.hash, tte);
+    ++ttstats.probes;
+    ttstats.hits += tthit;
+    if (tthit) {
         tte.move.s = scoreFromTrans(tte.move.s, ply, MATE - MAXPLY);
         if (!inRoot && !inPv && tte.depth >= depth && (tte.getBound() == TT_EXACT
             || (tte.getBound() == TT_LOWER && tte.move.s >= beta)
-            || (tte.getBound() == TT_UPPER && tte.move.s <= alpha)))
+            || (tte.getBound() == TT_UPPER && tte.move.s <= alpha))) {
+            ++ttstats.cutoffs;
             return tte.move.s;
+        }
     }
 
-    int evalscore = et.retrieve(pos); // TODO: optimize
+    int evalscore = tthit && tte.eval != TT_NO_EVAL ? tte.eval : evaluate();
     const bool nonpawnpcs = pos.colorBB[pos.side] & ~(pos.piecesBB[PAWN] | pos.piecesBB[KING]);
 
     if (!inRoot && !inPv && !inCheck) {
@@ -262,7 +272,7 @@ int search_t::search(bool inRoot, bool inPv, int alpha, int beta, int depth, int
         if (depth > 4 && std::abs(beta) < MATE - MAXPLY) {
             undo_t undo;
             int rbeta = std::min(beta + 100, MATE);
-            uint64_t dcc = pos.discoveredPiecesBB(pos.side);
+            uint64_t dcc = pos.discoveredBB();
             movepicker_t mp(*this, inCheck, true, rbeta - evalscore);
             for (move_t m; mp.getMoves(m);) {
                 bool moveGivesCheck = pos.moveIsCheck(m, dcc);
@@ -286,7 +296,7 @@ int search_t::search(bool inRoot, bool inPv, int alpha, int beta, int depth, int
     move_t lm = pos.stack.lastmove;
     uint16_t cm = countermove[pos.side][pos.getPiece(lm.moveTo())][lm.moveTo()];
     movepicker_t mp(*this, inCheck, false, 1, tte.move.m, killer1[ply], killer2[ply], cm);
-    uint64_t dcc = pos.discoveredPiecesBB(pos.side);
+    uint64_t dcc = pos.discoveredBB();
     bool skipquiets = false;
     playedmoves[ply].size = 0;
     for (move_t m; mp.getMoves(m, skipquiets);) {
@@ -331,7 +341,9 @@ int search_t::search(bool inRoot, bool inPv, int alpha, int beta, int depth, int
                 }
                 move_hash = pos.stack.hash >> 32;
                 move_hash ^= (m.m * 1664525) + 1013904223;
+                ++abdadastats.checks;
                 if (e.mht.isBusy(move_hash, depth)) {
+                    ++abdadastats.deferred;
                     m.s = movestried;
                     mp.deferred.add(m);
                     continue;
@@ -355,9 +367,9 @@ int search_t::search(bool inRoot, bool inPv, int alpha, int beta, int depth, int
                 reduction = std::min(depth - 1, std::max(reduction, 1));
             }
 
-            if (e.doSMP && mp.stage != STG_DEFERRED && depth >= e.defer_depth) e.mht.setBusy(move_hash, depth);
+            if (e.doSMP && mp.stage != STG_DEFERRED && depth >= e.defer_depth) ++abdadastats.marks[e.mht.setBusy(move_hash, depth)];
             score = -search(false, false, -alpha - 1, -alpha, depth - reduction, ply + 1, moveGivesCheck);
-            if (e.doSMP && mp.stage != STG_DEFERRED && depth >= e.defer_depth) e.mht.resetBusy(move_hash, depth);
+            if (e.doSMP && mp.stage != STG_DEFERRED && depth >= e.defer_depth) abdadastats.lost += !e.mht.resetBusy(move_hash, depth);
 
             if (reduction > 1 && !e.stop && !stop_iter && score > alpha)
                 score = -search(false, false, -alpha - 1, -alpha, depth - 1, ply + 1, moveGivesCheck);
@@ -400,7 +412,7 @@ int search_t::search(bool inRoot, bool inPv, int alpha, int beta, int depth, int
         }
     }
     best_move.s = scoreToTrans(best_score, ply, MATE - MAXPLY);
-    e.tt.store(pos.stack.hash, best_move, depth, (best_score >= beta) ? TT_LOWER : ((inPv && best_move.m != 0) ? TT_EXACT : TT_UPPER));
+    ++ttstats.stores[e.tt.store(pos.stack.hash, best_move, depth, (best_score >= beta) ? TT_LOWER : ((inPv && best_move.m != 0) ? TT_EXACT : TT_UPPER), evalscore)];
     return best_score;
 }
 
@@ -413,30 +425,49 @@ int search_t::qsearch(bool inPv, int alpha, int beta, int ply, bool inCheck) {
 
     if (ply > maxplysearched) maxplysearched = ply;
     if (pos.stack.fifty > 99 || pos.isRepeat() || pos.isMatDrawn()) return 0;
-    if (ply >= MAXPLY) return et.retrieve(pos);
+    if (ply >= MAXPLY) return eval.score(pos);
 
     tt_entry_t tte;
     tte.move.m = 0;
-    if (e.tt.retrieve(pos.stack.hash, tte)) {
+    bool tthit = e.tt.retrieve(pos.stack.hash, tte);
+    ++ttstats.probes;
+    ttstats.hits += tthit;
+    if (tthit) {
         tte.move.s = scoreFromTrans(tte.move.s, ply, MATE - MAXPLY);
         if (!inPv && (tte.getBound() == TT_EXACT
             || (tte.getBound() == TT_LOWER && tte.move.s >= beta)
-            || (tte.getBound() == TT_UPPER && tte.move.s <= alpha)))
+            || (tte.getBound() == TT_UPPER && tte.move.s <= alpha))) {
+            ++ttstats.cutoffs;
             return tte.move.s;
+        }
     }
 
+    const int old_alpha = alpha;
+    // stand pat only compares the eval against the window, so it can take a lazy estimate when far outside it.
+    // The estimate is no bound on the real eval, so such a node stores no eval and only a result its moves proved
+    int evalscore = tthit ? tte.eval : TT_NO_EVAL, ttevalscore = evalscore;
+    bool lazy = false;
+    if (!inCheck && evalscore == TT_NO_EVAL) {
+        evalscore = evaluate(alpha, beta);
+        lazy = eval.lazy;
+        ttevalscore = lazy ? TT_NO_EVAL : evalscore;
+    }
     int best_score = -MATE;
+    move_t best_move(0);
     if (!inCheck) {
-        best_score = et.retrieve(pos);
-        if (best_score >= beta) return best_score;
+        best_score = evalscore;
+        if (best_score >= beta) {
+            best_move.s = scoreToTrans(best_score, ply, MATE - MAXPLY);
+            if (!lazy) ++ttstats.stores[e.tt.store(pos.stack.hash, best_move, 0, TT_LOWER, ttevalscore)];
+            return best_score;
+        }
         alpha = std::max(alpha, best_score);
     }
 
     undo_t undo;
-    move_t best_move(0);
     int movestried = 0;
     movepicker_t mp(*this, inCheck, true, std::max(1, alpha - best_score - 100), tte.move.m);
-    uint64_t dcc = pos.discoveredPiecesBB(pos.side);
+    uint64_t dcc = pos.discoveredBB();
     for (move_t m; mp.getMoves(m);) {
         ++movestried;
         bool moveGivesCheck = pos.moveIsCheck(m, dcc);
@@ -455,11 +486,26 @@ int search_t::qsearch(bool inPv, int alpha, int beta, int ply, bool inCheck) {
             }
         }
     }
-    if (movestried == 0 && inCheck) return -MATE + ply;
-    // TODO: store qsearch result in trans table?
+    if (movestried == 0 && inCheck) best_score = -MATE + ply;
+
+    // depth 0 entries never satisfy the depth check in search(), only qsearch cuts on them
+    int bound = best_score >= beta ? TT_LOWER : ((inPv && best_score > old_alpha) ? TT_EXACT : TT_UPPER);
+    best_move.s = scoreToTrans(best_score, ply, MATE - MAXPLY);
+    if (!lazy || bound == TT_LOWER) ++ttstats.stores[e.tt.store(pos.stack.hash, best_move, 0, bound, ttevalscore)];
     return best_score;
 }
 
+// static eval on a TT miss, saved in a boundless entry so later visits from any thread get it from the TT
+int search_t::evaluate(int alpha, int beta) {
+    move_t none(0);
+    none.s = 0;
+    int evalscore = eval.score(pos, alpha, beta);
+    ++evalcnt;
+    // an early exit is only good against this window, keep it out of the table
+    if (!eval.lazy) ++ttstats.stores[e.tt.store(pos.stack.hash, none, 0, TT_NONE, evalscore)];
+    return evalscore;
+}
+
 void search_t::updateHistory(position_t& p, move_t bm, int depth, int ply) {
     depth = std::min(15, depth);
     int bonus = depth * depth;
@@ -11,6 +11,7 @@
 #include "utils.h"
 #include "log.h"
 #include "eval.h"
+#include "nnue.h"
 
 namespace Search {
     void initArr();
@@ -29,16 +30,20 @@ public:
     }
     void wait() {
         std::unique_lock<std::mutex> lk(thread_lock);
-        sleep_condition.wait(lk);
+        sleep_condition.wait(lk, [&] { return !do_sleep || exit_flag; });
     }
     void wakeup() {
-        do_sleep = false;
+        {
+            std::lock_guard<std::mutex> lk(thread_lock);
+            do_sleep = false;
+        }
         sleep_condition.notify_one();
     }
-    bool do_sleep;
+    std::atomic<bool> do_sleep;
+    std::function<void()> task; // run instead of a search on the next wakeup
     int thread_id;
 protected:
-    bool exit_flag;
+    std::atomic<bool> exit_flag;
     std::thread native_thread;
     std::condition_variable sleep_condition;
     std::mutex thread_lock;
@@ -48,28 +53,40 @@ struct engine_t;
 
 struct search_t : public thread_t {
     search_t(int _thread_id, engine_t& _e) : e(_e), thread_t(_thread_id) {
+        pawntable.init(2); // 2Mb
+        pawntable.clear();
+        eval.pawntable = &pawntable;
+        mattable.init(1); // 1Mb
+        mattable.clear();
+        eval.mattable = &mattable;
         native_thread = std::thread(&search_t::idleloop, this);
-        et.init(1);
     }
 
     void idleloop();
     uint64_t perft(size_t depth);
-    uint64_t perft2(int depth);
+    uint64_t perft2(int depth, perft_table_t* pt);
     void updateInfo();
     void displayInfo(move_t bestmove, int depth, int alpha, int beta);
     void start();
     bool stopSearch();
     int search(bool inRoot, bool inPv, int alpha, int beta, int depth, int ply, bool inCheck);
     int qsearch(bool inPv, int alpha, int beta, int ply, bool inCheck);
+    int evaluate(int alpha = -MATE, int beta = MATE);
     void updateHistory(position_t& p, move_t bm, int depth, int ply);
 
     position_t pos;
     engine_t& e;
-    eval_table_t et;
+    eval_t eval;
+    pawn_table_t pawntable;
+    material_table_t mattable;
+    NNUE::acc_stack_t nnuestack;
 
     int maxplysearched;
     int rdepth;
     std::atomic<uint64_t> nodecnt;
+    uint64_t evalcnt;
+    tt_stats_t ttstats;
+    abdada_stats_t abdadastats;
     std::atomic<bool> stop_iter;
 
     move_t rootmove;
@@ -4,80 +4,250 @@
 /*  ed_apostol@yahoo.com                          */
 /**************************************************/
 
+#include <cstdio>
+#include <fstream>
+#include <vector>
 #include "trans.h"
 #include "log.h"
 
-int eval_table_t::retrieve(position_t& pos) {
-    eval_hash_entry_t *entry = &getEntry(pos.stack.hash).bucket[0], *replace = entry;
-    uint32_t lock32 = lock(pos.stack.hash);
-    for (int t = 5; t--; ++entry) {
-        if (entry->hashlock == lock32)
-            return entry->eval;
-    }
-    replace->hashlock = lock32;
-    replace->eval = eval.score(pos);
-    return replace->eval;
-}
-
 bool trans_table_t::retrieve(const uint64_t hash, tt_entry_t& ttentry) {
-    tt_entry_t *entry = &getEntry(hash).bucket[0];
-    for (int t = 3; t--; ++entry) {
-        if (entry->hashlock == lock(hash)) {
-            entry->setAge(currentAge);
-            ttentry = *entry;
+    tt_bucket_t& bucket = getEntry(hash);
+    uint64_t data;
+    for (int idx = 0; idx < TT_BUCKET_SIZE; ++idx) {
+        if (bucket.matches(idx, hash, data)) {
+            ttentry.unpack(data);
+            if (ttentry.getAge() != currentAge) {
+                ttentry.setAge(currentAge);
+                bucket.write(idx, hash, ttentry.pack());
+            }
             return true;
         }
     }
     return false;
 }
 
-void trans_table_t::store(uint64_t hash, move_t move, int depth, int bound) {
+int trans_table_t::store(uint64_t hash, move_t move, int depth, int bound, int eval) {
     int highest = INT_MIN;
-    tt_entry_t *entry = &getEntry(hash).bucket[0], *replace = entry;
-    for (int t = 3; t--; ++entry) {
-        if (entry->hashlock == lock(hash)) {
-            if (bound == TT_EXACT || depth >= entry->depth) {
-                replace = entry;
+    int replace = 0;
+    uint64_t replaced = 0;
+    bool found = false;
+    tt_bucket_t& bucket = getEntry(hash);
+    tt_entry_t entry;
+    uint64_t data;
+    for (int idx = 0; idx < TT_BUCKET_SIZE; ++idx) {
+        found = bucket.matches(idx, hash, data);
+        entry.unpack(data);
+        if (found) {
+            // an eval-only store fills in the eval a lazily evaluated qsearch node left out, keeping its result
+            if (bound == TT_NONE && entry.getBound() != TT_NONE) {
+                entry.eval = eval;
+                bucket.write(idx, hash, entry.pack());
+                return TT_STORE_UPDATED;
+            }
+            // an exact result may replace a deeper bound, but a qsearch one is never worth a searched entry
+            if ((bound == TT_EXACT && depth > 0) || depth >= entry.depth) {
+                replace = idx;
                 break;
             }
-            else return;
+            else return TT_STORE_SKIPPED;
         }
-        int score = (((64 + currentAge - entry->getAge()) % 64) << 8) - entry->depth;
+        // oldest first, then shallowest, and eval-only entries go before searched ones of the same depth
+        int score = (((64 + currentAge - entry.getAge()) % 64) << 8) - 2 * entry.depth - (entry.getBound() != TT_NONE);
         if (score > highest) {
             highest = score;
-            replace = entry;
+            replace = idx;
+            replaced = data;
         }
     }
-    replace->hashlock = lock(hash);
-    replace->setAgeAndBound(currentAge, bound);
-    replace->move = move;
-    replace->depth = depth;
+    int result = TT_STORE_UPDATED;
+    if (!found) {
+        entry.unpack(replaced);
+        result = replaced == 0 ? TT_STORE_EMPTY : (entry.getAge() != currentAge ? TT_STORE_AGED : TT_STORE_DEPTH);
+    }
+    entry.setAgeAndBound(currentAge, bound);
+    // fail-low qsearch nodes have no move and lazily evaluated ones no eval, keep those already known for this position
+    if (!found || move.m != 0) entry.move.m = move.m;
+    entry.move.s = move.s;
+    entry.depth = depth;
+    if (!found || eval != TT_NO_EVAL) entry.eval = eval;
+    bucket.write(replace, hash, entry.pack());
+    bucket.setSpot(replace, int((hash * tabsize) >> 58));
+    return result;
 }
 
-void abdada_table_t::setBusy(const uint32_t hash, int depth) {
-    int lowest = INT_MAX;
-    uint32_t key = hashkey(hash, depth);
-    move_hash_t *entry = &getEntry(hash).bucket[0], *replace = entry;
-    for (int t = 4; t--; ++entry) {
-        if (entry->hashlock == key) return;
-        if (entry->depth() < lowest) lowest = entry->depth(), replace = entry;
+// permill of sampled entries written or refreshed by the current search, as UCI hashfull
+int trans_table_t::hashfull() {
+    const uint64_t buckets = std::min<uint64_t>(tabsize, 1000 / TT_BUCKET_SIZE);
+    int used = 0;
+    tt_entry_t entry;
+    for (uint64_t b = 0; b < buckets; ++b) {
+        for (int idx = 0; idx < TT_BUCKET_SIZE; ++idx) {
+            uint64_t data = table[b].data[idx].load(std::memory_order_relaxed);
+            entry.unpack(data);
+            used += data != 0 && entry.getAge() == currentAge;
+        }
     }
-    replace->hashlock = key;
+    return int(used * 1000 / (buckets * TT_BUCKET_SIZE));
+}
+
+// keeps the current buckets aside and allocates the new ones, which rehash() then fills slice by slice
+void trans_table_t::beginResize(uint64_t mb) {
+    oldtable = table, oldsize = tabsize, oldsource = source;
+    table = nullptr;
+    allocate(mb);
 }
 
-void abdada_table_t::resetBusy(const uint32_t hash, int depth) {
-    uint32_t key = hashkey(hash, depth);
-    move_hash_t *entry = &getEntry(hash).bucket[0];
-    for (int t = 4; t--; ++entry) {
-        if (entry->hashlock == key) entry->hashlock = 0;
+// Fills new buckets [idx, idx + 1) * tabsize / total from the old buckets covering the same hash range, keeping the
+// best entries the same way store() picks victims. An entry's old bucket and spot narrow its key down to 1/64 of the
+// old bucket's range, which lies in a single new bucket unless a new bucket boundary cuts through it. Those few
+// entries cannot be placed and are dropped.
+uint64_t trans_table_t::rehash(uint64_t idx, uint64_t total) {
+    const uint64_t start = tabsize * idx / total, end = tabsize * (idx + 1) / total;
+    uint64_t kept = 0;
+    tt_entry_t entry;
+    for (uint64_t b = start; b < end; ++b) {
+        uint64_t data[TT_BUCKET_SIZE] = {};
+        uint32_t check[TT_BUCKET_SIZE] = {};
+        int spot[TT_BUCKET_SIZE] = {};
+        int value[TT_BUCKET_SIZE];
+        for (auto& v : value) v = INT_MIN;
+        const uint64_t first = b * oldsize / tabsize, last = ((b + 1) * oldsize - 1) / tabsize;
+        for (uint64_t o = first; o <= last; ++o) {
+            // new bucket of old spot sp is floor((64 * o + sp) * tabsize / (64 * oldsize)), split so nothing overflows
+            const uint64_t q = o * tabsize / oldsize, r = o * tabsize % oldsize;
+            for (int slot = 0; slot < TT_BUCKET_SIZE; ++slot) {
+                uint64_t d = oldtable[o].data[slot].load(std::memory_order_relaxed);
+                if (d == 0) continue;
+                const uint64_t sp = oldtable[o].spot(slot);
+                const uint64_t lo = q + (64 * r + sp * tabsize) / (64 * oldsize);
+                const uint64_t hi = q + (64 * r + (sp + 1) * tabsize - 1) / (64 * oldsize);
+                if (lo != b || hi != b) continue;
+                entry.unpack(d);
+                int v = -(((64 + currentAge - entry.getAge()) % 64) << 8) + 2 * entry.depth + (entry.getBound() != TT_NONE);
+                int worst = 0;
+                for (int k = 1; k < TT_BUCKET_SIZE; ++k)
+                    if (value[k] < value[worst]) worst = k;
+                if (v <= value[worst]) continue;
+                value[worst] = v;
+                data[worst] = d;
+                check[worst] = oldtable[o].check[slot].load(std::memory_order_relaxed);
+                // the new spot is where that 1/64 starts, which a growing table can only place within tabsize / oldsize spots
+                spot[worst] = int((64 * ((64 * r + sp * tabsize) % (64 * oldsize)) / (64 * oldsize)));
+            }
+        }
+        // the check only depends on the low half of the key and the data, so it moves over unchanged
+        table[b].spots.store(0, std::memory_order_relaxed);
+        for (int slot = 0; slot < TT_BUCKET_SIZE; ++slot) {
+            table[b].data[slot].store(data[slot], std::memory_order_relaxed);
+            table[b].check[slot].store(check[slot], std::memory_order_relaxed);
+            table[b].setSpot(slot, spot[slot]);
+            kept += data[slot] != 0;
+        }
     }
+    return kept;
+}
+
+void trans_table_t::endResize() {
+    Utils::freeMemory(oldtable, oldsize * sizeof(tt_bucket_t), oldsource);
+    oldtable = nullptr;
 }
 
+bool trans_table_t::save(const std::string& filename) {
+    tt_file_header_t header;
+    memcpy(header.magic, TT_FILE_MAGIC, sizeof(header.magic));
+    header.version = TT_FILE_VERSION;
+    header.bucketsize = sizeof(tt_bucket_t);
+    header.buckets = tabsize;
+    header.age = currentAge;
+
+    std::vector<char> page(TT_FILE_HEADER, 0);
+    memcpy(page.data(), &header, sizeof(header));
+    // a loaded table may still be mapped from filename, so the dump goes to a new file that replaces it at the end
+    const std::string tmpname = filename + ".tmp";
+    std::ofstream file(tmpname, std::ios::binary | std::ios::trunc);
+    file.write(page.data(), page.size());
+    file.write((const char*)table, tabsize * sizeof(tt_bucket_t));
+    file.close();
+    if (!file || std::rename(tmpname.c_str(), filename.c_str()) != 0) {
+        std::remove(tmpname.c_str());
+        LogAndPrintOutput() << "savehash: cannot write " << filename;
+        return false;
+    }
+    return true;
+}
+
+bool trans_table_t::load(const std::string& filename) {
+    tt_file_header_t header;
+    std::ifstream file(filename, std::ios::binary);
+    if (!file.read((char*)&header, sizeof(header))) {
+        LogAndPrintOutput() << "loadhash: cannot read " << filename;
+        return false;
+    }
+    if (memcmp(header.magic, TT_FILE_MAGIC, sizeof(header.magic)) || header.version != TT_FILE_VERSION || header.bucketsize != sizeof(tt_bucket_t)) {
+        LogAndPrintOutput() << "loadhash: " << filename << " is not a version " << TT_FILE_VERSION << " hash file";
+        return false;
+    }
+    if (header.buckets != tabsize) {
+        LogAndPrintOutput() << "loadhash: " << filename << " holds " << ((header.buckets * sizeof(tt_bucket_t)) >> 20)
+            << "MB of buckets, set Hash to that size first";
+        return false;
+    }
+    const size_t bytes = tabsize * sizeof(tt_bucket_t);
+    // a shared table is filled in place so the other processes see the loaded entries
+    void* mem = isShared() ? nullptr : Utils::mapFile(filename, TT_FILE_HEADER, bytes);
+    if (mem) {
+        release();
+        table = (tt_bucket_t*)mem;
+        source = Utils::MEM_FILE;
+    }
+    else if (!file.seekg(TT_FILE_HEADER) || !file.read((char*)table, bytes)) {
+        clear();
+        LogAndPrintOutput() << "loadhash: " << filename << " is truncated";
+        return false;
+    }
+    currentAge = header.age;
+    return true;
+}
+
+int abdada_table_t::setBusy(const uint32_t hash, int depth) {
+    const uint32_t key = hashkey(hash, depth);
+    move_hash_t* bucket = getEntry(uint64_t(hash) << 32).bucket;
+    while (true) {
+        int lowest = INT_MAX, replace = 0;
+        uint64_t words[4];
+        bool raced = false;
+        for (int idx = 0; idx < 4 && !raced; ++idx) {
+            uint64_t w = words[idx] = bucket[idx].word.load(std::memory_order_relaxed);
+            if (move_hash_t::key(w) == key) {
+                if (bucket[idx].word.compare_exchange_weak(w, w + 1, std::memory_order_relaxed))
+                    return move_hash_t::refs(w) ? ABDADA_MARK_SHARED : ABDADA_MARK_NEW;
+                raced = true;
+            }
+            // idle slots first, then the shallowest one in use
+            int score = move_hash_t::refs(w) ? move_hash_t::depth(w) : -1;
+            if (score < lowest) lowest = score, replace = idx;
+        }
+        if (!raced && bucket[replace].word.compare_exchange_weak(words[replace], move_hash_t::make(key, 1), std::memory_order_relaxed))
+            return lowest < 0 ? ABDADA_MARK_NEW : ABDADA_MARK_EVICTED;
+    }
+}
+bool abdada_table_t::resetBusy(const uint32_t hash, int depth) {
+    const uint32_t key = hashkey(hash, depth);
+    move_hash_t* bucket = getEntry(uint64_t(hash) << 32).bucket;
+    for (int idx = 0; idx < 4; ++idx) {
+        uint64_t w = bucket[idx].word.load(std::memory_order_relaxed);
+        while (move_hash_t::key(w) == key && move_hash_t::refs(w)) {
+            if (bucket[idx].word.compare_exchange_weak(w, w - 1, std::memory_order_relaxed)) return true;
+        }
+    }
+    return false;
+}
 bool abdada_table_t::isBusy(const uint32_t hash, int depth) {
-    uint32_t key = hashkey(hash, depth);
-    move_hash_t *entry = &getEntry(hash).bucket[0];
-    for (int t = 4; t--; ++entry) {
-        if (entry->hashlock == key) return true;
+    const uint32_t key = hashkey(hash, depth);
+    move_hash_t* bucket = getEntry(uint64_t(hash) << 32).bucket;
+    for (int idx = 0; idx < 4; ++idx) {
+        uint64_t w = bucket[idx].word.load(std::memory_order_relaxed);
+        if (move_hash_t::key(w) == key && move_hash_t::refs(w)) return true;
     }
     return false;
 }
\ No newline at end of file
@@ -8,99 +8,254 @@
 
 #include <algorithm>
 #include <cstring>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
 #include "typedefs.h"
+#include "utils.h"
 #include "log.h"
-#include "eval.h"
 
 template <typename hash_entity_t>
 class hashtable_t {
 public:
-    hashtable_t() : table(nullptr), tabsize(0), mask(0) {}
-    ~hashtable_t() { delete[] table; }
-    void clear() { memset(table, 0, tabsize * sizeof(hash_entity_t)); }
-    hash_entity_t& getEntry(const uint64_t hash) { return table[hash & mask]; }
+    hashtable_t() : table(nullptr), tabsize(0), pagemode(Utils::PAGES_MADVISE), source(Utils::MEM_HEAP) {}
+    ~hashtable_t() { release(); }
+    void clear() { memset((void*)table, 0, tabsize * sizeof(hash_entity_t)); }
+    void clear(uint64_t idx, uint64_t total) {
+        uint64_t start = tabsize * idx / total, end = tabsize * (idx + 1) / total;
+        memset((void*)(table + start), 0, (end - start) * sizeof(hash_entity_t));
+    }
+    // maps the hash onto [0, tabsize) with a multiply-high, so the table size need not be a power of two
+    hash_entity_t& getEntry(const uint64_t hash) {
+#ifdef _MSC_VER
+        return table[__umulh(hash, tabsize)];
+#else
+        return table[uint64_t(((unsigned __int128)hash * tabsize) >> 64)];
+#endif
+    }
+    // pulls the bucket for the hash into cache, issued as soon as a new key is known so the probe does not stall
+    void prefetch(const uint64_t hash) {
+#ifdef _MSC_VER
+        _mm_prefetch((const char*)&getEntry(hash), _MM_HINT_T0);
+#else
+        __builtin_prefetch(&getEntry(hash));
+#endif
+    }
+    uint64_t size() const { return tabsize; }
+    void setPageMode(int mode) { pagemode = mode; }
+    void setSegment(const std::string& name) { segment = name; }
+    void setInterleave(bool on) { interleave = on; }
+    bool isShared() const { return source == Utils::MEM_SHARED; }
     void init(uint64_t mb) {
         //PrintOutput() << sizeof(hash_entity_t);
-        tabsize = (1 << 20) / sizeof(hash_entity_t); // at least 1MB
-        for (mb <<= 19; tabsize * sizeof(hash_entity_t) <= mb; tabsize <<= 1);
-        mask = tabsize - 1;
-        delete[] table;
-        table = new hash_entity_t[tabsize];
-        clear();
+        release();
+        allocate(mb);
     }
     uint32_t lock(uint64_t hash) const { return hash >> 32; }
 
 protected:
+    void allocate(uint64_t mb) {
+        tabsize = std::max<uint64_t>(1, (mb << 20) / sizeof(hash_entity_t));
+        if (!segment.empty() && (table = (hash_entity_t*)Utils::mapShared(segment, tabsize * sizeof(hash_entity_t))))
+            source = Utils::MEM_SHARED;
+        else {
+            // the GUI has to know the processes no longer share their entries, the reason is in the log
+            if (!segment.empty())
+                LogAndPrintOutput() << "info string hash segment " << segment << " unavailable, using a private " << mb << "MB table";
+            table = (hash_entity_t*)Utils::allocMemory(tabsize * sizeof(hash_entity_t), pagemode, source);
+            if (interleave) Utils::interleaveMemory(table, tabsize * sizeof(hash_entity_t));
+        }
+    }
+    void release() {
+        Utils::freeMemory(table, tabsize * sizeof(hash_entity_t), source);
+        table = nullptr;
+    }
     hash_entity_t *table;
     uint64_t tabsize;
-    uint64_t mask;
-};
-
-#pragma pack(push, 1)
-struct eval_hash_entry_t {
-    uint32_t hashlock;
-    int16_t eval;
-};
-#pragma pack(pop)
-
-struct eval_bucket_t {
-    eval_hash_entry_t bucket[5];
-    uint16_t padding;
+    int pagemode;
+    int source;
+    std::string segment;
+    bool interleave = false;
 };
 
-class eval_table_t : public hashtable_t < eval_bucket_t > {
-public:
-    int retrieve(position_t& pos);
-    eval_t eval;
-};
-
-#pragma pack(push, 1)
 struct tt_entry_t {
-    uint32_t hashlock;
-    move_t move;
-    uint8_t depth;
     int getAge() { return age & 63; }
     int getBound() { return age >> 6; }
     void setAgeAndBound(int a, int b) { age = a | (b << 6); }
     void setAge(int a) { age &= 192; age |= a; }
+    uint64_t pack() const {
+        return uint64_t(move.m) | (uint64_t(uint16_t(move.s)) << 16) | (uint64_t(depth) << 32) | (uint64_t(age) << 40)
+            | (uint64_t(uint16_t(eval)) << 48);
+    }
+    void unpack(uint64_t data) {
+        move.m = uint16_t(data);
+        move.s = int16_t(data >> 16);
+        depth = uint8_t(data >> 32);
+        age = uint8_t(data >> 40);
+        eval = int16_t(data >> 48);
+    }
+    move_t move;
+    uint8_t depth;
+    int16_t eval;
 private:
     uint8_t age;
 };
-#pragma pack(pop)
 
-struct tt_bucket_t {
-    tt_entry_t bucket[3];
-    uint16_t padding;
+const int TT_BUCKET_SIZE = 5;
+const int TT_NO_EVAL = -32768; // eval of an entry stored without a full static eval
+
+// one cache line per bucket: five 64-bit data words and their 32-bit checks, a slot is valid when its
+// check equals the low half of the hash xored with the folded data, so a torn write reads as a miss.
+// The last word keeps six bits per slot of where the key falls inside the bucket's share of the hash
+// range, which is what a resize needs to find the one new bucket of each entry
+struct alignas(64) tt_bucket_t {
+    static uint32_t fold(uint64_t d) { return uint32_t(d) ^ uint32_t(d >> 32); }
+    bool matches(int idx, uint64_t hash, uint64_t& d) const {
+        d = data[idx].load(std::memory_order_relaxed);
+        return (check[idx].load(std::memory_order_relaxed) ^ fold(d)) == uint32_t(hash);
+    }
+    void write(int idx, uint64_t hash, uint64_t d) {
+        data[idx].store(d, std::memory_order_relaxed);
+        check[idx].store(uint32_t(hash) ^ fold(d), std::memory_order_relaxed);
+    }
+    int spot(int idx) const { return (spots.load(std::memory_order_relaxed) >> (6 * idx)) & 63; }
+    // all slots share the word, so the update is a compare-and-swap that cannot lose another thread's spot
+    void setSpot(int idx, int sp) {
+        uint32_t s = spots.load(std::memory_order_relaxed);
+        while (!spots.compare_exchange_weak(s, (s & ~(63u << (6 * idx))) | (uint32_t(sp) << (6 * idx)), std::memory_order_relaxed));
+    }
+    std::atomic<uint64_t> data[TT_BUCKET_SIZE];
+    std::atomic<uint32_t> check[TT_BUCKET_SIZE];
+    std::atomic<uint32_t> spots;
 };
+static_assert(sizeof(tt_bucket_t) == 64, "tt_bucket_t must fill exactly one cache line");
 
 enum TTBounds {
-    TT_EXACT = 1,
+    TT_NONE,
+    TT_EXACT,
     TT_LOWER,
     TT_UPPER
 };
 
+enum TTStoreResults {
+    TT_STORE_SKIPPED, // same position already stored deeper
+    TT_STORE_UPDATED, // same position overwritten
+    TT_STORE_EMPTY,
+    TT_STORE_AGED, // evicted an entry from an older search
+    TT_STORE_DEPTH, // evicted a shallower entry of the current search
+    TT_STORE_RESULTS
+};
+
+// per-thread counters, plain integers so the search pays no atomic traffic for them
+struct tt_stats_t {
+    void clear() { *this = tt_stats_t(); }
+    void add(const tt_stats_t& s) {
+        probes += s.probes, hits += s.hits, cutoffs += s.cutoffs, collisions += s.collisions;
+        for (int r = 0; r < TT_STORE_RESULTS; ++r) stores[r] += s.stores[r];
+    }
+    uint64_t probes = 0;
+    uint64_t hits = 0;
+    uint64_t cutoffs = 0;
+    uint64_t collisions = 0; // hash moves that failed validation
+    uint64_t stores[TT_STORE_RESULTS] = {};
+};
+
+struct tt_file_header_t {
+    char magic[8];
+    uint32_t version;
+    uint32_t bucketsize;
+    uint64_t buckets;
+    int32_t age;
+};
+
+const char TT_FILE_MAGIC[8] = { 'I', 'N', 'V', 'I', 'C', 'T', 'T', 'T' };
+const uint32_t TT_FILE_VERSION = 2;
+const size_t TT_FILE_HEADER = 4096; // header padded to a page so the buckets can be mapped straight from the file
+
 class trans_table_t : public hashtable_t < tt_bucket_t > {
 public:
+    bool save(const std::string& filename);
+    bool load(const std::string& filename);
     void resetAge() { currentAge = 0; }
     void updateAge() { currentAge = (currentAge + 1) % 64; }
-    void store(uint64_t hash, move_t move, int depth, int bound);
+    int store(uint64_t hash, move_t move, int depth, int bound, int eval);
     bool retrieve(uint64_t hash, tt_entry_t& ttentry);
+    int hashfull();
+    bool resizable() const { return table != nullptr && !isShared(); }
+    void beginResize(uint64_t mb);
+    uint64_t rehash(uint64_t idx, uint64_t total);
+    void endResize();
 private:
-    int currentAge;
+    int currentAge = 0;
+    tt_bucket_t* oldtable = nullptr; // the buckets being rehashed during a resize
+    uint64_t oldsize = 0;
+    int oldsource = Utils::MEM_HEAP;
 };
 
+// 32-bit key (move hash with the depth in the low byte) over a 32-bit count of threads searching the move,
+// updated with compare-and-swap so concurrent marks on one slot are never lost
 struct move_hash_t {
-    uint32_t hashlock;
-    int depth() { return hashlock & 0xff; };
+    static uint64_t make(uint32_t key, uint32_t refs) { return (uint64_t(key) << 32) | refs; }
+    static uint32_t key(uint64_t w) { return uint32_t(w >> 32); }
+    static uint32_t refs(uint64_t w) { return uint32_t(w); }
+    static int depth(uint64_t w) { return (w >> 32) & 0xff; }
+    std::atomic<uint64_t> word;
 };
 
-struct movehash_bucket_t {
+struct alignas(32) movehash_bucket_t {
     move_hash_t bucket[4];
 };
 
+enum ABDADAMarkResults {
+    ABDADA_MARK_NEW, // claimed an empty or idle slot
+    ABDADA_MARK_SHARED, // another thread was already searching the move, so the busy check missed it
+    ABDADA_MARK_EVICTED, // replaced a slot still in use, whose owners now read as not busy
+    ABDADA_MARK_RESULTS
+};
+
+// per-thread counters like tt_stats_t, these measure how much work the deferral saves and how often it fails
+struct abdada_stats_t {
+    void clear() { *this = abdada_stats_t(); }
+    void add(const abdada_stats_t& s) {
+        checks += s.checks, deferred += s.deferred, lost += s.lost;
+        for (int r = 0; r < ABDADA_MARK_RESULTS; ++r) marks[r] += s.marks[r];
+    }
+    uint64_t checks = 0;
+    uint64_t deferred = 0; // busy checks that found the move in use
+    uint64_t lost = 0; // marks already gone when the search of the move finished
+    uint64_t marks[ABDADA_MARK_RESULTS] = {};
+};
+
+// move hashes are 32 bits, shifted up so the multiply-high index uses all of them
 struct abdada_table_t : public hashtable_t < movehash_bucket_t > {
-    void setBusy(uint32_t hash, int depth);
-    void resetBusy(uint32_t hash, int depth);
+    int setBusy(uint32_t hash, int depth);
+    bool resetBusy(uint32_t hash, int depth);
     bool isBusy(uint32_t hash, int depth);
     uint32_t hashkey(uint32_t hash, int depth) { return (hash & 0xffffff00) | depth; };
-};
\ No newline at end of file
+};
+
+// one leaf count per slot, verified like the TT buckets: the check word is the hash xored with the data word,
+// which holds the depth in its top byte and the count below, so a torn write reads as a miss
+struct perft_entry_t {
+    std::atomic<uint64_t> check;
+    std::atomic<uint64_t> data;
+};
+
+class perft_table_t : public hashtable_t < perft_entry_t > {
+public:
+    bool retrieve(uint64_t hash, int depth, uint64_t& count) {
+        perft_entry_t& entry = getEntry(hash);
+        uint64_t d = entry.data.load(std::memory_order_relaxed);
+        if ((entry.check.load(std::memory_order_relaxed) ^ d) != hash || int(d >> 56) != depth) return false;
+        count = d & CountMask;
+        return true;
+    }
+    void store(uint64_t hash, int depth, uint64_t count) {
+        perft_entry_t& entry = getEntry(hash);
+        uint64_t d = (uint64_t(depth) << 56) | (count & CountMask);
+        entry.data.store(d, std::memory_order_relaxed);
+        entry.check.store(hash ^ d, std::memory_order_relaxed);
+    }
+private:
+    static const uint64_t CountMask = (1ULL << 56) - 1;
+};
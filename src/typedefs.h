@@ -131,6 +131,8 @@ typedef long double basic_score_t;
 typedef int16_t basic_score_t;
 #endif
 
+#ifdef TUNE
+// the tuner adjusts each half through a reference, so it keeps them as separate fields
 struct score_t {
     score_t() : m(0), e(0) {};
     score_t(basic_score_t mm, basic_score_t ee) : m(mm), e(ee) {}
@@ -151,10 +153,36 @@ struct score_t {
     inline score_t& operator/=(const int x) { m /= x, e /= x; return *this; }
     inline score_t& operator*=(const int x) { m *= x, e *= x; return *this; }
     inline bool operator==(const score_t &d) { return (d.e == e) && (d.m == m); }
+    basic_score_t mg() const { return m; }
+    basic_score_t eg() const { return e; }
 
     basic_score_t m;
     basic_score_t e;
 };
+#else
+// midgame in the low 16 bits and endgame in the high 16 bits, so one 32-bit add, subtract or multiply
+// updates both halves; a negative midgame borrows one from the endgame half, which eg() adds back
+struct score_t {
+    constexpr score_t() : v(0) {}
+    constexpr score_t(int mm, int ee) : v(int32_t(uint32_t(ee) << 16) + mm) {}
+    inline score_t operator+(const score_t &d) const { return fromPacked(v + d.v); }
+    inline score_t operator-(const score_t &d) const { return fromPacked(v - d.v); }
+    inline score_t operator-() const { return fromPacked(-v); }
+    inline score_t operator*(const int x) const { return fromPacked(v * x); }
+    inline score_t operator/(const int x) const { return score_t(mg() / x, eg() / x); }
+    inline score_t& operator+=(const score_t &d) { v += d.v; return *this; }
+    inline score_t& operator-=(const score_t &d) { v -= d.v; return *this; }
+    inline score_t& operator*=(const int x) { v *= x; return *this; }
+    inline score_t& operator/=(const int x) { return *this = *this / x; }
+    inline bool operator==(const score_t &d) const { return v == d.v; }
+    inline int mg() const { return int16_t(uint16_t(uint32_t(v))); }
+    inline int eg() const { return int16_t(uint16_t((uint32_t(v) + 0x8000) >> 16)); }
+
+    int32_t v;
+private:
+    static score_t fromPacked(int32_t p) { score_t s; s.v = p; return s; }
+};
+#endif
 
 class spinlock_t {
 public:
@@ -172,6 +200,7 @@ private:
 };
 
 struct material_t {
+    uint64_t key;
     score_t value;
     int16_t phase;
     int16_t flags;
@@ -12,6 +12,22 @@
 #include "eval.h"
 #include "params.h"
 #include "tune.h"
+#include "nnue.h"
+
+namespace {
+    const std::vector<std::string> BenchFENs = {
+        "r3k2r/pbpnqp2/1p1ppn1p/6p1/2PP4/2PBPNB1/P4PPP/R2Q1RK1 w kq - 2 12",
+        "2kr3r/pbpn1pq1/1p3n2/3p1R2/3P3p/2P2Q2/P1BN2PP/R3B2K w - - 4 22",
+        "r2n1rk1/1pq2ppp/p2pbn2/8/P3Pp2/2PBB2P/2PNQ1P1/1R3RK1 w - - 0 17",
+        "1r2r2k/1p4qp/p3bp2/4p2R/n3P3/2PB4/2PB1QPK/1R6 w - - 1 32",
+        "1b3r1k/rb1q3p/pp2pppP/3n1n2/1P2N3/P2B1NPQ/1B3P2/2R1R1K1 b - - 1 32",
+        "1r1r1qk1/pn1p2p1/1pp1npBp/8/2PB2QP/4R1P1/P4PK1/3R4 w - - 0 1",
+        "3rr1k1/1b2nnpp/1p1q1p2/pP1p1P2/P1pP2P1/2N1P1QP/3N1RB1/2R3K1 w - - 0 1",
+        "r1bqk1nr/ppp2pbp/2n1p1p1/7P/3Pp3/2N2N2/PPP2PP1/R1BQKB1R w KQkq - 0 7",
+        "1r3rk1/3bb1pp/1qn1p3/3pP3/3P1N2/2Q2N2/2P3PP/R1BR3K w - - 0 1",
+        "rn1q1rk1/2pbb3/pn2p3/1p1pPpp1/3P4/1PNBBN2/P1P1Q1PP/R4R1K w - - 0 1"
+    };
+}
 
 const std::string uci_t::name = "Invictus";
 const std::string uci_t::author = "Edsel Apostol";
@@ -29,7 +45,6 @@ uci_t::uci_t() {
     Attacks::initArr();
     PositionData::initArr();
     EvalParam::initArr();
-    EvalParam::initMaterial();
     Search::initArr();
     //EvalParam::displayPST();
     engine.origpos.setPosition(StartFEN);
@@ -59,10 +74,19 @@ bool uci_t::input(iss& stream) {
     else if (cmd == "uci") displayID();
     else if (cmd == "perft") perftbench(stream);
     else if (cmd == "perft2") perft(stream);
+    else if (cmd == "divide") divide(stream);
     else if (cmd == "eval") eval();
     else if (cmd == "moves") moves();
     else if (cmd == "d") displaypos();
     else if (cmd == "speedup") speedup(stream);
+    else if (cmd == "bench") bench(stream);
+    else if (cmd == "ttstress") ttstress(stream);
+    else if (cmd == "savehash") savehash(stream);
+    else if (cmd == "loadhash") loadhash(stream);
+    else if (cmd == "ttstats") ttstats();
+    else if (cmd == "evalbench") evalbench(stream);
+    else if (cmd == "nnuecheck") nnuecheck(stream);
+    else if (cmd == "checkbench") checkbench(stream);
     else if (cmd == "tune") tune();
     else LogAndPrintOutput() << "Invalid cmd: " << cmd;
 
@@ -171,16 +195,23 @@ void uci_t::tune() {
 #endif
 }
 
+// runs perft.epd at [depth] on all threads with a perft hash of Hash MB, which is kept over the whole suite
+// since its entries are keyed on the position
 void uci_t::perftbench(iss& stream) {
     size_t depth;
     stream >> depth;
 
+    perft_table_t pt;
+    pt.init(engine.options["Hash"].getIntVal());
+    pt.clear();
+
     std::ifstream infile("perft.epd");
     std::string line;
     uint64_t totaltime = 0;
     uint64_t totalnodes = 0;
     int cnt = 0;
     int correct = 0;
+    int unchecked = 0;
     while (std::getline(infile, line))
     {
         size_t split = 0;
@@ -197,23 +228,39 @@ void uci_t::perftbench(iss& stream) {
         split = line.find(';');
         std::string fen = line.substr(0, split);
         PrintOutput() << "\n" << ++cnt << ": " << fen;
-        engine[0]->pos.setPosition(fen.c_str());
+        position_t pos(fen);
 
         uint64_t oldtime = Utils::getTime();
 
-        uint64_t nodes = engine[0]->perft(depth);
-        //uint64_t nodes = engine[0]->perft2(depth);
+        uint64_t nodes = engine.perft(pos, int(depth), &pt);
 
         totalnodes += nodes;
         uint64_t timespent = Utils::getTime() - oldtime;
         totaltime += timespent;
         PrintOutput() << "nodes: " << nodes << " time: " << timespent << " ms";
 
-        if (nodes == n[depth - 1]) ++correct;
+        if (depth > n.size()) ++unchecked;
+        else if (nodes == n[depth - 1]) ++correct;
         else PrintOutput() << "FAILED: " << fen << " correct nodes: " << n[depth - 1] << " current: " << nodes;
     }
 
-    PrintOutput() << "\n" << correct << "/" << cnt << " NPS: " << (totalnodes * 1000 / (totaltime + 1)) << " totaltime: " << totaltime << " ms";
+    PrintOutput() << "\n" << correct << "/" << cnt - unchecked << " NPS: " << (totalnodes * 1000 / (totaltime + 1)) << " totaltime: " << totaltime << " ms"
+        << (unchecked ? " (" + std::to_string(unchecked) + " positions without a count at this depth)" : "");
+}
+
+// leaf count under each root move of the current position, then the total, with the same perft hash and threads
+void uci_t::divide(iss& stream) {
+    int depth = 1;
+    stream >> depth;
+    perft_table_t pt;
+    pt.init(engine.options["Hash"].getIntVal());
+    pt.clear();
+    std::vector<std::pair<move_t, uint64_t>> counts;
+    uint64_t oldtime = Utils::getTime();
+    uint64_t nodes = engine.perft(engine.origpos, depth, &pt, &counts);
+    uint64_t timespent = Utils::getTime() - oldtime;
+    for (auto& c : counts) PrintOutput() << c.first.to_str() << ": " << c.second;
+    PrintOutput() << "\nmoves: " << counts.size() << " nodes: " << nodes << " time: " << timespent << " ms NPS: " << (nodes * 1000 / (timespent + 1));
 }
 
 void uci_t::perft(iss& stream) {
@@ -245,18 +292,6 @@ void uci_t::displaypos() {
 
 void uci_t::speedup(iss& stream) {
     iss streamcmd;
-    std::vector<std::string> fenPos = {
-        "r3k2r/pbpnqp2/1p1ppn1p/6p1/2PP4/2PBPNB1/P4PPP/R2Q1RK1 w kq - 2 12",
-        "2kr3r/pbpn1pq1/1p3n2/3p1R2/3P3p/2P2Q2/P1BN2PP/R3B2K w - - 4 22",
-        "r2n1rk1/1pq2ppp/p2pbn2/8/P3Pp2/2PBB2P/2PNQ1P1/1R3RK1 w - - 0 17",
-        "1r2r2k/1p4qp/p3bp2/4p2R/n3P3/2PB4/2PB1QPK/1R6 w - - 1 32",
-        "1b3r1k/rb1q3p/pp2pppP/3n1n2/1P2N3/P2B1NPQ/1B3P2/2R1R1K1 b - - 1 32",
-        "1r1r1qk1/pn1p2p1/1pp1npBp/8/2PB2QP/4R1P1/P4PK1/3R4 w - - 0 1",
-        "3rr1k1/1b2nnpp/1p1q1p2/pP1p1P2/P1pP2P1/2N1P1QP/3N1RB1/2R3K1 w - - 0 1",
-        "r1bqk1nr/ppp2pbp/2n1p1p1/7P/3Pp3/2N2N2/PPP2PP1/R1BQKB1R w KQkq - 0 7",
-        "1r3rk1/3bb1pp/1qn1p3/3pP3/3P1N2/2Q2N2/2P3PP/R1BR3K w - - 0 1",
-        "rn1q1rk1/2pbb3/pn2p3/1p1pPpp1/3P4/1PNBBN2/P1P1Q1PP/R4R1K w - - 0 1"
-    };
 
     std::vector<int> threads;
     int depth;
@@ -267,8 +302,8 @@ void uci_t::speedup(iss& stream) {
     std::vector<double> timeSpeedupSum(threads.size(), 0.0);
     std::vector<double> nodesSpeedupSum(threads.size(), 0.0);
 
-    for (size_t idxpos = 0; idxpos < fenPos.size(); ++idxpos) {
-        LogAndPrintOutput() << "\n\nPos#" << idxpos + 1 << ": " << fenPos[idxpos];
+    for (size_t idxpos = 0; idxpos < BenchFENs.size(); ++idxpos) {
+        LogAndPrintOutput() << "\n\nPos#" << idxpos + 1 << ": " << BenchFENs[idxpos];
         uint64_t nodes1 = 0;
         uint64_t spentTime1 = 0;
         for (size_t idxthread = 0; idxthread < threads.size(); ++idxthread) {
@@ -276,7 +311,7 @@ void uci_t::speedup(iss& stream) {
             setoption(streamcmd);
             newgame();
 
-            streamcmd = iss("fen " + fenPos[idxpos]);
+            streamcmd = iss("fen " + BenchFENs[idxpos]);
             positioncmd(streamcmd);
 
             uint64_t startTime = Utils::getTime();
@@ -312,11 +347,326 @@ void uci_t::speedup(iss& stream) {
         }
     }
     LogAndPrintOutput() << "\n\n";
-    LogAndPrintOutput() << "Threads: " << std::to_string(threads[0]) << " time: " << std::to_string(timeSpeedupSum[0] / fenPos.size()) << "s, "
-        << std::to_string(nodesSpeedupSum[0] / fenPos.size()) << "knps";
+    LogAndPrintOutput() << "Threads: " << std::to_string(threads[0]) << " time: " << std::to_string(timeSpeedupSum[0] / BenchFENs.size()) << "s, "
+        << std::to_string(nodesSpeedupSum[0] / BenchFENs.size()) << "knps";
     for (size_t idxthread = 1; idxthread < threads.size(); ++idxthread) {
         LogAndPrintOutput() << "Threads: " << std::to_string(threads[idxthread])
-            << " time: " << std::to_string(timeSpeedupSum[idxthread] / fenPos.size()) << " nodes: " << std::to_string(nodesSpeedupSum[idxthread] / fenPos.size());
+            << " time: " << std::to_string(timeSpeedupSum[idxthread] / BenchFENs.size()) << " nodes: " << std::to_string(nodesSpeedupSum[idxthread] / BenchFENs.size());
     }
     LogAndPrintOutput() << "\n\n";
+}
+
+// bench [depth] [prefetch], the prefetch mode runs the positions twice with bucket prefetching off and on
+void uci_t::bench(iss& stream) {
+    int depth = 13;
+    std::string mode;
+    stream >> depth >> mode;
+
+    std::vector<bool> prefetches = { true };
+    if (mode == "prefetch") prefetches = { false, true };
+    std::vector<uint64_t> nps;
+    for (bool prefetch : prefetches) {
+        engine.doPrefetch = prefetch;
+        uint64_t totalnodes = 0;
+        uint64_t totalevals = 0;
+        uint64_t totalprobes = 0;
+        uint64_t totalhits = 0;
+        uint64_t totaltime = 0;
+        for (size_t idxpos = 0; idxpos < BenchFENs.size(); ++idxpos) {
+            iss streamcmd;
+            newgame();
+            streamcmd = iss("fen " + BenchFENs[idxpos]);
+            positioncmd(streamcmd);
+
+            uint64_t startTime = Utils::getTime();
+            streamcmd = iss("depth " + std::to_string(depth));
+            gocmd(streamcmd);
+            engine.waitForThreads();
+            uint64_t spentTime = Utils::getTime() - startTime;
+
+            uint64_t nodes = engine.nodesearched();
+            uint64_t evals = engine.evalscomputed();
+            totalnodes += nodes;
+            totalevals += evals;
+            totaltime += spentTime;
+            for (auto t : engine) totalprobes += t->ttstats.probes, totalhits += t->ttstats.hits;
+            LogAndPrintOutput() << "Pos#" << idxpos + 1 << " nodes: " << nodes << " time: " << spentTime << " ms evals/node: " << (double)evals / (nodes + 1);
+        }
+        nps.push_back(totalnodes * 1000 / (totaltime + 1));
+        LogAndPrintOutput() << "\nnodes: " << totalnodes << " time: " << totaltime << " ms NPS: " << nps.back()
+            << " evals/node: " << (double)totalevals / (totalnodes + 1) << " tt hits: " << (100.0 * totalhits / (totalprobes + 1)) << "%"
+            << (prefetches.size() > 1 ? (prefetch ? " prefetch: on\n" : " prefetch: off\n") : "");
+    }
+    if (nps.size() > 1)
+        LogAndPrintOutput() << "prefetch speedup: " << (100.0 * nps[1] / std::max<uint64_t>(nps[0], 1) - 100.0) << "%";
+    engine.doPrefetch = true;
+}
+
+// times the eval alone over every position within [depth] plies of the bench positions, visited in
+// move generation order like a search would, once computing the pawn terms every time and once with a pawn hash
+void uci_t::evalbench(iss& stream) {
+    int depth = 3;
+    stream >> depth;
+
+    std::vector<position_t> positions;
+    std::function<void(position_t&, int)> collect = [&](position_t& p, int d) {
+        movelist_t<256> ml;
+        undo_t undo;
+        p.genLegal(ml);
+        for (move_t m : ml) {
+            p.doMove(undo, m);
+            if (d > 1) collect(p, d - 1);
+            else {
+                positions.push_back(p);
+                positions.back().history = std::vector<uint64_t>(); // the eval never looks at it
+            }
+            p.undoMove(undo);
+        }
+    };
+    for (auto& fen : BenchFENs) {
+        position_t p(fen);
+        collect(p, depth);
+    }
+
+    for (bool cached : { false, true }) {
+        eval_t eval;
+        pawn_table_t pawntable;
+        material_table_t mattable;
+        if (cached) {
+            pawntable.init(2);
+            pawntable.clear();
+            eval.pawntable = &pawntable;
+            mattable.init(1);
+            mattable.clear();
+            eval.mattable = &mattable;
+        }
+        int64_t checksum = 0;
+        uint64_t startTime = Utils::getTime();
+        for (auto& p : positions) checksum += eval.score(p);
+        uint64_t spentTime = Utils::getTime() - startTime;
+        LogAndPrintOutput() << (cached ? "pawn/material hash: " : "no pawn/material hash: ") << positions.size() << " evals in " << spentTime << " ms, "
+            << (spentTime * 1000000 / std::max<size_t>(positions.size(), 1)) << " ns/eval, pawn hits: "
+            << (100.0 * eval.pawnhits / std::max<uint64_t>(eval.pawnprobes, 1)) << "% checksum: " << checksum;
+    }
+
+    // how far the rest of the eval moves the early exit estimate, anything beyond LazyMargin is a wrong exit
+    eval_t eval;
+    uint64_t misses = 0;
+    int maxerror = 0;
+    for (auto& p : positions) {
+        int error = std::abs(int(eval.score(p) - eval.lazyscore));
+        misses += error > EvalParam::LazyMargin;
+        maxerror = std::max(maxerror, error);
+    }
+    LogAndPrintOutput() << "lazy margin " << EvalParam::LazyMargin << " exceeded by " << misses << " evals ("
+        << (100.0 * misses / std::max<size_t>(positions.size(), 1)) << "%), max error " << maxerror;
+}
+
+// compares the incrementally updated network output against a full refresh over a perft tree of the current
+// position, leaving some nodes unevaluated so the updates also run over several plies and null moves at once
+void uci_t::nnuecheck(iss& stream) {
+    int depth = 4;
+    stream >> depth;
+    if (!NNUE::loaded()) {
+        LogAndPrintOutput() << "nnuecheck: no network loaded, set EvalFile first";
+        return;
+    }
+    std::unique_ptr<NNUE::acc_stack_t> accs(new NNUE::acc_stack_t);
+    position_t p = engine.origpos;
+    p.nnue = accs.get();
+    NNUE::reset(*accs, p);
+    uint64_t nodes = 0, errors = 0;
+    std::function<void(int)> walk = [&](int d) {
+        if (d == 0 || d % 2) ++nodes, errors += NNUE::evaluate(p) != NNUE::evaluateFull(p);
+        if (d == 0) return;
+        movelist_t<256> ml;
+        undo_t undo;
+        if (d > 1 && !p.kingIsInCheck()) {
+            p.doNullMove(undo);
+            ++nodes, errors += NNUE::evaluate(p) != NNUE::evaluateFull(p);
+            p.undoNullMove(undo);
+        }
+        p.genLegal(ml);
+        for (move_t m : ml) {
+            p.doMove(undo, m);
+            walk(d - 1);
+            p.undoMove(undo);
+        }
+    };
+    uint64_t startTime = Utils::getTime();
+    walk(depth);
+    LogAndPrintOutput() << "nnuecheck: " << nodes << " evals, " << errors << " mismatches, " << (Utils::getTime() - startTime) << " ms";
+}
+
+// times check detection over the pseudo-legal moves of every position within [depth] plies of the bench
+// positions, as the movepicker sees them, and the quiet check generator against filtering all quiet moves
+void uci_t::checkbench(iss& stream) {
+    int depth = 3;
+    stream >> depth;
+
+    std::vector<position_t> positions;
+    std::function<void(position_t&, int)> collect = [&](position_t& p, int d) {
+        movelist_t<256> ml;
+        undo_t undo;
+        p.genLegal(ml);
+        for (move_t m : ml) {
+            p.doMove(undo, m);
+            if (d > 1) collect(p, d - 1);
+            else if (!p.kingIsInCheck()) {
+                positions.push_back(p);
+                positions.back().history = std::vector<uint64_t>();
+            }
+            p.undoMove(undo);
+        }
+    };
+    for (auto& fen : BenchFENs) {
+        position_t p(fen);
+        collect(p, depth);
+    }
+
+    // every node starts with nothing cached, like a fresh node in the search
+    uint64_t moves = 0, checks = 0;
+    uint64_t startTime = Utils::getTime();
+    for (auto& p : positions) {
+        movelist_t<256> ml;
+        p.stack.ci.valid = 0;
+        p.genTacticalMoves(ml);
+        p.genQuietMoves(ml);
+        uint64_t dcc = p.discoveredBB();
+        for (move_t m : ml) checks += p.moveIsCheck(m, dcc);
+        moves += ml.size;
+    }
+    uint64_t spentTime = Utils::getTime() - startTime;
+    LogAndPrintOutput() << "moveIsCheck: " << positions.size() << " positions, " << moves << " moves, " << checks << " checks in "
+        << spentTime << " ms, " << (spentTime * 1000000 / std::max<uint64_t>(moves, 1)) << " ns/move";
+
+    uint64_t filtered = 0, generated = 0, mismatches = 0;
+    startTime = Utils::getTime();
+    for (auto& p : positions) {
+        movelist_t<256> ml;
+        p.stack.ci.valid = 0;
+        p.genQuietMoves(ml);
+        uint64_t dcc = p.discoveredBB();
+        for (move_t m : ml) filtered += p.moveIsCheck(m, dcc);
+    }
+    uint64_t filterTime = Utils::getTime() - startTime;
+    startTime = Utils::getTime();
+    for (auto& p : positions) {
+        movelist_t<256> ml;
+        p.stack.ci.valid = 0;
+        p.genQuietChecks(ml);
+        generated += ml.size;
+    }
+    uint64_t genTime = Utils::getTime() - startTime;
+    for (auto& p : positions) {
+        movelist_t<256> quiets, qchecks;
+        p.genQuietMoves(quiets);
+        p.genQuietChecks(qchecks);
+        uint64_t dcc = p.discoveredBB();
+        int n = 0;
+        for (move_t m : quiets) {
+            if (!p.moveIsCheck(m, dcc)) continue;
+            ++n;
+            mismatches += std::none_of(qchecks.begin(), qchecks.end(), [&](const move_t& q) { return q.m == m.m; });
+        }
+        mismatches += n != qchecks.size;
+    }
+    LogAndPrintOutput() << "quiet checks: " << filtered << " by filtering in " << filterTime << " ms, " << generated
+        << " generated in " << genTime << " ms, " << mismatches << " mismatches";
+}
+
+void uci_t::savehash(iss& stream) {
+    std::string filename;
+    std::getline(stream >> std::ws, filename);
+    uint64_t startTime = Utils::getTime();
+    if (engine.tt.save(filename))
+        LogAndPrintOutput() << "savehash: " << ((engine.tt.size() * sizeof(tt_bucket_t)) >> 20) << "MB in " << (Utils::getTime() - startTime) << " ms";
+}
+
+// transposition, pawn and ABDADA table counters summed over all threads for the last search
+void uci_t::ttstats() {
+    tt_stats_t stats;
+    for (auto t : engine) stats.add(t->ttstats);
+    auto pct = [](uint64_t n, uint64_t d) { return std::to_string(100.0 * n / std::max<uint64_t>(d, 1)) + "%"; };
+    uint64_t stores = 0;
+    for (auto n : stats.stores) stores += n;
+    LogAndPrintOutput() << "hashfull: " << engine.tt.hashfull() << " permill, " << engine.tt.size() * TT_BUCKET_SIZE << " entries";
+    LogAndPrintOutput() << "probes: " << stats.probes << " hits: " << stats.hits << " (" << pct(stats.hits, stats.probes) << ")"
+        << " cutoffs: " << stats.cutoffs << " (" << pct(stats.cutoffs, stats.probes) << ")"
+        << " collisions: " << stats.collisions << " (" << pct(stats.collisions, stats.hits) << " of hits)";
+    LogAndPrintOutput() << "stores: " << stores << " updated: " << pct(stats.stores[TT_STORE_UPDATED], stores)
+        << " skipped: " << pct(stats.stores[TT_STORE_SKIPPED], stores) << " empty: " << pct(stats.stores[TT_STORE_EMPTY], stores)
+        << " overwrite-by-age: " << pct(stats.stores[TT_STORE_AGED], stores) << " overwrite-by-depth: " << pct(stats.stores[TT_STORE_DEPTH], stores);
+
+    uint64_t pawnprobes = 0, pawnhits = 0;
+    for (auto t : engine) pawnprobes += t->eval.pawnprobes, pawnhits += t->eval.pawnhits;
+    LogAndPrintOutput() << "pawn hash probes: " << pawnprobes << " hits: " << pawnhits << " (" << pct(pawnhits, pawnprobes) << ")";
+    uint64_t lazyexits[LAZY_EXITS] = {};
+    for (auto t : engine) for (int x = 0; x < LAZY_EXITS; ++x) lazyexits[x] += t->eval.lazyexits[x];
+    LogAndPrintOutput() << "lazy eval exits above beta: " << lazyexits[LAZY_HIGH] << " (" << pct(lazyexits[LAZY_HIGH], pawnprobes) << ")"
+        << " below alpha: " << lazyexits[LAZY_LOW] << " (" << pct(lazyexits[LAZY_LOW], pawnprobes) << ")";
+
+    abdada_stats_t abdada;
+    for (auto t : engine) abdada.add(t->abdadastats);
+    uint64_t marks = 0;
+    for (auto n : abdada.marks) marks += n;
+    LogAndPrintOutput() << "abdada checks: " << abdada.checks << " deferred: " << abdada.deferred << " (" << pct(abdada.deferred, abdada.checks) << ")"
+        << " marks: " << marks << " duplicated: " << abdada.marks[ABDADA_MARK_SHARED] << " (" << pct(abdada.marks[ABDADA_MARK_SHARED], marks) << ")"
+        << " evicted: " << abdada.marks[ABDADA_MARK_EVICTED] << " lost: " << abdada.lost;
+}
+
+// load after ucinewgame, since a new game clears the table
+void uci_t::loadhash(iss& stream) {
+    std::string filename;
+    std::getline(stream >> std::ws, filename);
+    uint64_t startTime = Utils::getTime();
+    if (engine.tt.load(filename))
+        LogAndPrintOutput() << "loadhash: " << ((engine.tt.size() * sizeof(tt_bucket_t)) >> 20) << "MB in " << (Utils::getTime() - startTime) << " ms";
+}
+
+// hammers a small shared table from many threads, each stored entry is derived from its key so any
+// hit whose data does not match the key is a torn/corrupted read
+void uci_t::ttstress(iss& stream) {
+    int numthreads = 8, millis = 5000;
+    stream >> numthreads >> millis;
+
+    trans_table_t table;
+    table.init(1);
+    table.clear();
+    std::atomic<bool> done(false);
+    std::atomic<uint64_t> probes(0), hits(0), corrupted(0);
+    std::vector<std::thread> workers;
+
+    auto hashkey = [](uint64_t x) {
+        x += 0x9e3779b97f4a7c15ull;
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+        return x ^ (x >> 31);
+    };
+    for (int t = 0; t < numthreads; ++t) {
+        workers.emplace_back([&, t] {
+            uint64_t localprobes = 0, localhits = 0, localcorrupted = 0;
+            for (uint64_t n = t; !done; ++n) {
+                uint64_t hash = hashkey(hashkey(n) & 0xffff); // small key set so threads collide
+                move_t move(uint16_t(hash >> 16));
+                move.s = int16_t(hash >> 32);
+                int depth = (hash >> 48) & 0x7f;
+                tt_entry_t tte;
+                ++localprobes;
+                if (table.retrieve(hash, tte)) {
+                    ++localhits;
+                    if (tte.move.m != move.m || tte.move.s != move.s || tte.depth != depth || tte.eval != int16_t(hash)) ++localcorrupted;
+                }
+                table.store(hash, move, depth, TT_EXACT, int16_t(hash));
+            }
+            probes += localprobes;
+            hits += localhits;
+            corrupted += localcorrupted;
+        });
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(millis));
+    done = true;
+    for (auto& w : workers) w.join();
+
+    LogAndPrintOutput() << "ttstress threads: " << numthreads << " probes: " << probes << " hits: " << hits << " corrupted: " << corrupted;
 }
\ No newline at end of file
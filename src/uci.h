@@ -35,10 +35,19 @@ private:
     void tune();
     void perftbench(iss& stream);
     void perft(iss& stream);
+    void divide(iss& stream);
     void eval();
     void moves();
     void displaypos();
     void speedup(iss& stream);
+    void bench(iss& stream);
+    void ttstress(iss& stream);
+    void savehash(iss& stream);
+    void loadhash(iss& stream);
+    void ttstats();
+    void evalbench(iss& stream);
+    void nnuecheck(iss& stream);
+    void checkbench(iss& stream);
 
     static const std::string name;
     static const std::string author;
@@ -4,11 +4,28 @@
 /*  ed_apostol@yahoo.com                          */
 /**************************************************/
 
+#include <algorithm>
 #include <chrono>
+#include <cstdlib>
+#include <fstream>
 #include <iostream>
+#include <new>
+#include <sstream>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#else
+#include <malloc.h>
+#endif
 #include "typedefs.h"
 #include "constants.h"
 #include "utils.h"
+#include "log.h"
 
 namespace Utils {
     void printBitBoard(uint64_t b) {
@@ -27,8 +44,233 @@ namespace Utils {
         using namespace std::chrono;
         return duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count();
     }
+
+    // hash tables are 2MB aligned so the kernel can back them with huge pages and cut TLB misses
+    const size_t HugePageSize = 2 * 1024 * 1024;
+
 #ifndef _WIN32
-    void bindThisThread(int index) { (void)index; };
+    void* allocMemory(size_t size, int mode, int& source) {
+        size = (size + HugePageSize - 1) / HugePageSize * HugePageSize;
+        source = MEM_HEAP;
+#ifdef MAP_HUGETLB
+        if (mode == PAGES_HUGETLB) {
+            void* mem = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+            if (mem != MAP_FAILED) {
+                source = MEM_HUGETLB;
+                return mem;
+            }
+            LogInfo() << "hugetlbfs allocation of " << (size >> 20) << "MB failed, falling back to transparent huge pages";
+        }
+#endif
+        void* mem = aligned_alloc(HugePageSize, size);
+        if (!mem) throw std::bad_alloc();
+#if defined(MADV_HUGEPAGE) && defined(MADV_NOHUGEPAGE)
+        madvise(mem, size, mode == PAGES_OFF ? MADV_NOHUGEPAGE : MADV_HUGEPAGE);
+#endif
+        return mem;
+    }
+
+    // private copy-on-write mapping: pages load lazily and writes never reach the file
+    void* mapFile(const std::string& filename, size_t offset, size_t size) {
+        int fd = open(filename.c_str(), O_RDONLY);
+        if (fd == -1) return nullptr;
+        struct stat st;
+        void* mem = MAP_FAILED;
+        if (fstat(fd, &st) == 0 && size_t(st.st_size) >= offset + size)
+            mem = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, offset);
+        close(fd);
+        if (mem == MAP_FAILED) return nullptr;
+#ifdef MADV_WILLNEED
+        madvise(mem, size, MADV_WILLNEED);
+#endif
+        return mem;
+    }
+
+    // named POSIX shared memory so several engine processes on one host can share a table,
+    // the first process creates and sizes the segment, later ones must ask for the same size
+    void* mapShared(const std::string& name, size_t size) {
+        bool created = true;
+        int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+        if (fd == -1) {
+            created = false;
+            fd = shm_open(name.c_str(), O_RDWR, 0600);
+        }
+        if (fd == -1) {
+            LogInfo() << "cannot open shared memory segment " << name;
+            return nullptr;
+        }
+        struct stat st;
+        void* mem = MAP_FAILED;
+        if (created && ftruncate(fd, size) == -1)
+            LogInfo() << "cannot size shared memory segment " << name << " to " << (size >> 20) << "MB";
+        else if (fstat(fd, &st) == 0 && size_t(st.st_size) != size)
+            LogInfo() << "shared memory segment " << name << " has " << (st.st_size >> 20) << "MB, expected " << (size >> 20) << "MB";
+        else
+            mem = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (mem == MAP_FAILED) {
+            if (created) shm_unlink(name.c_str());
+            return nullptr;
+        }
+        LogInfo() << (created ? "created" : "attached to") << " shared memory segment " << name << " of " << (size >> 20) << "MB";
+        return mem;
+    }
+
+    void freeMemory(void* mem, size_t size, int source) {
+        if (!mem) return;
+        if (source == MEM_HUGETLB) munmap(mem, (size + HugePageSize - 1) / HugePageSize * HugePageSize);
+        else if (source == MEM_FILE || source == MEM_SHARED) munmap(mem, size);
+        else free(mem);
+    }
+#else
+    void* allocMemory(size_t size, int mode, int& source) {
+        (void)mode;
+        source = MEM_HEAP;
+        void* mem = _aligned_malloc(size, HugePageSize);
+        if (!mem) throw std::bad_alloc();
+        return mem;
+    }
+
+    void* mapFile(const std::string& filename, size_t offset, size_t size) {
+        (void)filename, (void)offset, (void)size;
+        return nullptr;
+    }
+
+    void* mapShared(const std::string& name, size_t size) {
+        (void)name, (void)size;
+        return nullptr;
+    }
+
+    void freeMemory(void* mem, size_t size, int source) {
+        (void)size, (void)source;
+        _aligned_free(mem);
+    }
+#endif
+
+#ifndef _WIN32
+    struct numa_topology_t {
+        std::vector<int> nodes; // sysfs node ids
+        std::vector<std::vector<int>> cpus; // usable cpus of each node, first hardware thread of every core first
+        std::vector<int> groups; // node index for each search thread index
+        cpu_set_t process; // affinity the process started with
+    };
+
+    std::vector<int> parseCpuList(const std::string& list) {
+        std::vector<int> ids;
+        std::stringstream ss(list);
+        std::string range;
+        while (std::getline(ss, range, ',')) {
+            if (range.empty() || !isdigit(range[0])) continue;
+            size_t dash = range.find('-');
+            int first = std::stoi(range), last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+            for (int id = first; id <= last; ++id) ids.push_back(id);
+        }
+        return ids;
+    }
+
+    std::string readSysFile(const std::string& path) {
+        std::string line;
+        std::ifstream file(path);
+        std::getline(file, line);
+        return line;
+    }
+
+    std::string cpuListToStr(const std::vector<int>& cpus) {
+        std::string str;
+        for (size_t i = 0; i < cpus.size(); ++i) {
+            size_t j = i;
+            while (j + 1 < cpus.size() && cpus[j + 1] == cpus[j] + 1) ++j;
+            str += (str.empty() ? "" : ",") + std::to_string(cpus[i]) + (j > i ? "-" + std::to_string(cpus[j]) : "");
+            i = j;
+        }
+        return str;
+    }
+
+    // read once from /sys, a kernel without NUMA support shows up as a single node holding every cpu we may run on
+    const numa_topology_t& numaTopology() {
+        static const numa_topology_t topology = [] {
+            numa_topology_t t;
+            CPU_ZERO(&t.process);
+            sched_getaffinity(0, sizeof(t.process), &t.process);
+            std::vector<int> nodes = parseCpuList(readSysFile("/sys/devices/system/node/online"));
+            if (nodes.empty()) nodes.push_back(0);
+            std::vector<int> smt;
+            for (int node : nodes) {
+                std::vector<int> cpus, siblings;
+                std::string list = readSysFile("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+                if (list.empty() && nodes.size() == 1) list = readSysFile("/sys/devices/system/cpu/online");
+                for (int cpu : parseCpuList(list)) {
+                    if (!CPU_ISSET(cpu, &t.process)) continue;
+                    std::vector<int> core = parseCpuList(readSysFile("/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/topology/thread_siblings_list"));
+                    (core.empty() || core[0] == cpu ? cpus : siblings).push_back(cpu);
+                }
+                if (cpus.empty()) continue;
+                for (size_t c = 0; c < cpus.size(); ++c) t.groups.push_back(int(t.nodes.size()));
+                for (size_t c = 0; c < siblings.size(); ++c) smt.push_back(int(t.nodes.size()));
+                cpus.insert(cpus.end(), siblings.begin(), siblings.end());
+                t.nodes.push_back(node);
+                t.cpus.push_back(cpus);
+            }
+            // hyperthreads come after all physical cores, spread over the nodes like the Windows version
+            std::vector<int> counts(t.nodes.size(), 0);
+            for (int n : smt) ++counts[n];
+            for (bool added = true; added;) {
+                added = false;
+                for (size_t n = 0; n < counts.size(); ++n)
+                    if (counts[n]) --counts[n], t.groups.push_back(int(n)), added = true;
+            }
+            std::string desc;
+            for (size_t n = 0; n < t.nodes.size(); ++n)
+                desc += " node" + std::to_string(t.nodes[n]) + ": " + cpuListToStr(t.cpus[n]);
+            LogInfo() << "numa: " << t.nodes.size() << " node(s)," << desc;
+            return t;
+        }();
+        return topology;
+    }
+
+    // threads are pinned to a node rather than a core and left to the scheduler within it, a negative index
+    // or a single node machine restores the original affinity
+    void bindThisThread(int index) {
+        static thread_local int boundNode = -1;
+        if (index < 0 && boundNode < 0) return;
+        const numa_topology_t& numa = numaTopology();
+        const int node = (index >= 0 && numa.nodes.size() > 1) ? numa.groups[index % numa.groups.size()] : -1;
+        if (node == boundNode) return;
+        cpu_set_t set = numa.process;
+        if (node >= 0) {
+            CPU_ZERO(&set);
+            for (int cpu : numa.cpus[node]) CPU_SET(cpu, &set);
+        }
+        if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0) {
+            LogInfo() << "thread " << index << ": cannot set cpu affinity";
+            return;
+        }
+        boundNode = node;
+        if (node >= 0) LogInfo() << "thread " << index << " bound to node" << numa.nodes[node] << " cpus " << cpuListToStr(numa.cpus[node]);
+        else LogInfo() << "thread " << index << " unbound";
+    }
+
+    // spreads the pages round-robin over all nodes so no socket holds the whole table, must run before first touch
+    bool interleaveMemory(void* mem, size_t size) {
+        const numa_topology_t& numa = numaTopology();
+#ifdef SYS_mbind
+        if (numa.nodes.size() > 1) {
+            const int MPOL_INTERLEAVE = 3;
+            const int maxnode = *std::max_element(numa.nodes.begin(), numa.nodes.end()) + 1;
+            std::vector<unsigned long> mask((maxnode + 63) / 64, 0);
+            for (int node : numa.nodes) mask[node / 64] |= 1ul << (node % 64);
+            size = (size + HugePageSize - 1) / HugePageSize * HugePageSize;
+            // the kernel counts maxnode one past the last bit it reads
+            if (syscall(SYS_mbind, mem, size, MPOL_INTERLEAVE, mask.data(), mask.size() * 64 + 1, 0) == 0) {
+                LogInfo() << "hash: " << (size >> 20) << "MB interleaved over " << numa.nodes.size() << " nodes";
+                return true;
+            }
+            LogInfo() << "hash: cannot interleave " << (size >> 20) << "MB over " << numa.nodes.size() << " nodes";
+        }
+#endif
+        (void)mem, (void)size, (void)numa;
+        return false;
+    }
 #else
 #include <windows.h>
 #define GetKnownProcAddress(hmod, F) (decltype(F)*)GetProcAddress(hmod, #F)
@@ -69,6 +311,11 @@ namespace Utils {
         return index < groups.size() ? groups[index] : -1;
     }
 
+    bool interleaveMemory(void* mem, size_t size) {
+        (void)mem, (void)size;
+        return false;
+    }
+
     void bindThisThread(int index) {
         int group;
         HMODULE kernel = GetModuleHandle("kernel32.dll");
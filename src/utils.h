@@ -9,7 +9,14 @@
 #include "position.h"
 
 namespace Utils {
+    enum PageModes { PAGES_OFF, PAGES_MADVISE, PAGES_HUGETLB };
+    enum MemorySources { MEM_HEAP, MEM_HUGETLB, MEM_FILE, MEM_SHARED };
     extern void printBitBoard(uint64_t n);
     extern uint64_t getTime(void);
     extern void bindThisThread(int index);
+    extern bool interleaveMemory(void* mem, size_t size);
+    extern void* allocMemory(size_t size, int mode, int& source);
+    extern void* mapFile(const std::string& filename, size_t offset, size_t size);
+    extern void* mapShared(const std::string& name, size_t size);
+    extern void freeMemory(void* mem, size_t size, int source);
 }
@@ -0,0 +1,63 @@
+#!/bin/sh
+# Two invictus processes on one Hash Segment: the first searches the start position and stays up, the second
+# then searches the same position and must probe the first one's entries. A third process with a private table
+# of the same size does the same search as the reference, the sharing one has to hit more and search less.
+#
+# usage: tests/shared_hash.sh [path to invictus]
+
+ENGINE=${1:-./invictus}
+SEGMENT=/invictus-test-$$
+DEPTH=12
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"; rm -f "/dev/shm$SEGMENT"' EXIT
+
+# waits until $1 has a line matching $2, at most 60 seconds
+wait_for() {
+    n=0
+    until grep -q "$2" "$1" 2>/dev/null; do
+        n=$((n + 1))
+        if [ $n -gt 600 ]; then echo "timed out waiting for '$2' in $1"; exit 1; fi
+        sleep 0.1
+    done
+}
+
+# runs one search in a process that exits when $WORK/$1.done appears, output in $WORK/$1.out
+start() {
+    (
+        printf 'setoption name Threads value 1\nsetoption name Hash value 16\n'
+        [ -n "$2" ] && printf 'setoption name Hash Segment value %s\n' "$2"
+        printf 'position startpos\ngo depth %d\n' $DEPTH
+        wait_for "$WORK/$1.out" '^bestmove'
+        printf 'ttstats\n'
+        wait_for "$WORK/$1.out" '^probes'
+        wait_for "$WORK/$1.done" .
+        printf 'quit\n'
+    ) | (cd "$WORK" && "$ENGINE") > "$WORK/$1.out" 2>&1 &
+}
+
+# hit rate in permill and node count of the search in $WORK/$1.out
+hits() { sed -n 's/^probes: \([0-9]*\) hits: \([0-9]*\).*/\2 \1/p' "$WORK/$1.out" | awk '{ print int(1000 * $1 / $2) }'; }
+nodes() { grep '^info time' "$WORK/$1.out" | tail -1 | sed 's/.* nodes \([0-9]*\).*/\1/'; }
+
+case "$ENGINE" in /*) ;; *) ENGINE=$(pwd)/$ENGINE ;; esac
+
+start first "$SEGMENT"
+wait_for "$WORK/first.out" '^probes'
+if grep -q 'unavailable' "$WORK/first.out"; then echo "first process could not create $SEGMENT"; exit 1; fi
+
+start second "$SEGMENT"
+start private ""
+wait_for "$WORK/second.out" '^probes'
+wait_for "$WORK/private.out" '^probes'
+echo x > "$WORK/first.done"
+echo x > "$WORK/second.done"
+echo x > "$WORK/private.done"
+wait
+
+if grep -q 'unavailable' "$WORK/second.out"; then echo "second process could not attach to $SEGMENT"; exit 1; fi
+echo "shared: $(nodes second) nodes, $(hits second) permill hits; private: $(nodes private) nodes, $(hits private) permill hits"
+if [ "$(hits second)" -le "$(hits private)" ] || [ "$(nodes second)" -ge "$(nodes private)" ]; then
+    echo "the second process did not use the first one's entries"
+    exit 1
+fi
+echo "ok"